@@ -1,7 +1,9 @@
 #include "game.h"
+#include "trace.h"
 
 int main(void) {
+    TRACE_THREAD_NAME("main");
     (void)game_run();
+    TRACE_DUMP_DEFAULT();
     return 0;
 }
-
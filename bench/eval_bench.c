@@ -0,0 +1,150 @@
+// eval_bench.c
+// Time full-board evaluation on random positions: the original
+// cell-by-cell scan, each window-count kernel available on this CPU,
+// the runtime-selected evaluate_board_scan(), and the incremental
+// EvalState read the search does at its leaves. Reports nanoseconds per evaluation, then the
+// positions/s of batch_run() (evaluations, legal and winning columns).
+//
+// Usage: eval_bench [POSITIONS [ROUNDS]]   (defaults 4096, 200)
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "board.h"
+#include "eval.h"
+#include "batch.h"
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/* Random legal positions with 0..ROWS*COLS pieces (wins are not checked). */
+static void random_positions(Board *boards, int n) {
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        Board *b = &boards[i];
+        board_init(b);
+        Cell p     = CELL_A;
+        int  plies = rand() % (ROWS * COLS + 1);
+        while (b->moves < plies) {
+            if (board_drop(b, 1 + rand() % COLS, p, NULL)) {
+                p = (p == CELL_A) ? CELL_B : CELL_A;
+            }
+        }
+    }
+}
+
+static void report(const char *name, double ms, long evals, long sink) {
+    printf("%-12s %8.2f ns/eval  (%.1f M evals/s, checksum %ld)\n",
+           name, ms * 1e6 / evals, evals / ms / 1e3, sink);
+}
+
+int main(int argc, char **argv) {
+    int n      = (argc > 1) ? atoi(argv[1]) : 4096;
+    int rounds = (argc > 2) ? atoi(argv[2]) : 200;
+    if (n < 1 || rounds < 1) {
+        fprintf(stderr, "usage: %s [POSITIONS [ROUNDS]]\n", argv[0]);
+        return 2;
+    }
+
+    Board *boards = malloc((size_t)n * sizeof(*boards));
+    if (!boards) {
+        perror("malloc");
+        return 1;
+    }
+    random_positions(boards, n);
+
+    long   evals = (long)n * rounds * 2;
+    long   sink;
+    double t0;
+
+    sink = 0;
+    t0   = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) {
+            sink += evaluate_board_reference(&boards[i], CELL_A);
+            sink += evaluate_board_reference(&boards[i], CELL_B);
+        }
+    }
+    report("reference", now_ms() - t0, evals, sink);
+
+    static const char *kernels[] = { "scalar", "avx2" };
+    Bitboard center = board_column_mask(COLS / 2);
+    for (int k = 0; k < 2; k++) {
+        EvalCountFn fn = eval_count_kernel(kernels[k]);
+        if (!fn) {
+            printf("%-12s not supported on this CPU\n", kernels[k]);
+            continue;
+        }
+        sink = 0;
+        t0   = now_ms();
+        for (int r = 0; r < rounds; r++) {
+            for (int i = 0; i < n; i++) {
+                const Board *b = &boards[i];
+                EvalCounts counts;
+                fn(b->stones[0], b->stones[1], &counts);
+                sink += eval_score_counts(&counts, b->stones[0] & center, b->stones[1] & center, 0);
+                sink += eval_score_counts(&counts, b->stones[1] & center, b->stones[0] & center, 1);
+            }
+        }
+        report(kernels[k], now_ms() - t0, evals, sink);
+    }
+
+    sink = 0;
+    t0   = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) {
+            sink += evaluate_board_scan(&boards[i], CELL_A);
+            sink += evaluate_board_scan(&boards[i], CELL_B);
+        }
+    }
+    report("scan", now_ms() - t0, evals, sink);
+    printf("%-12s uses the %s kernel\n", "scan", eval_count_kernel_name());
+
+    EvalState *states = malloc((size_t)n * sizeof(*states));
+    if (!states) {
+        perror("malloc");
+        free(boards);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        eval_state_init(&states[i], &boards[i]);
+    }
+
+    sink = 0;
+    t0   = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < n; i++) {
+            sink += eval_state_score(&states[i], CELL_A);
+            sink += eval_state_score(&states[i], CELL_B);
+        }
+    }
+    report("incremental", now_ms() - t0, evals, sink);
+    free(states);
+
+    PositionBatch pb;
+    if (batch_init(&pb, (size_t)n) != 0) {
+        perror("batch_init");
+        free(boards);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        batch_push(&pb, &boards[i]);
+    }
+
+    sink = 0;
+    t0   = now_ms();
+    for (int r = 0; r < rounds; r++) {
+        batch_run(&pb);
+        sink += pb.eval_a[r % n] + pb.win_b[r % n];
+    }
+    double ms = now_ms() - t0;
+    printf("%-12s %8.2f ns/position  (%.1f M positions/s, %s kernel, checksum %ld)\n",
+           "batch", ms * 1e6 / ((double)n * rounds),
+           (double)n * rounds / ms / 1e3, batch_kernel_name(), sink);
+
+    batch_free(&pb);
+    free(boards);
+    return 0;
+}
@@ -0,0 +1,324 @@
+// kernel_bench.c
+// Reference timings of the board-level kernels every engine optimization
+// is measured against: board_drop (with the board_undo that restores the
+// position), board_is_winning, board_is_full, evaluate_board,
+// would_win_if_drop and the threat-based pickers bot_pick_easy_plus and
+// bot_pick_medium. The searching pickers are timed by search_bench.
+//
+// Positions come from seeded random play, so every run and every build
+// sees the same ones. Each kernel runs a warm-up, then many samples of
+// one call per position of a batch; a sample's time divided by the batch
+// size is one ns/call value. Reports the median, p99, mean and minimum
+// over the samples, plus a checksum of the results so that a kernel
+// change which alters answers does not pass as a speed-up.
+//
+// Usage: kernel_bench [-n POSITIONS] [-b BATCH] [-w WARMUP] [-r SAMPLES]
+//                     [-s SEED] [-f text|csv|json]
+//   -n POSITIONS  random positions (default 4096)
+//   -b BATCH      calls per sample (default 256)
+//   -w WARMUP     unmeasured samples per kernel (default 200)
+//   -r SAMPLES    measured samples per kernel (default 2000)
+//   -s SEED       position seed (default 1)
+//   -f FORMAT     text table (default), csv, or one JSON object per line
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "eval.h"
+#include "bot.h"
+
+typedef struct {
+    Board board;
+    Cell  to_move;
+    int   col;   // a playable column (1-based) ...
+    int   row;   // ... and the row a piece dropped there lands on
+} Position;
+
+/* One call of a kernel on each of n positions; returns a result checksum. */
+typedef uint64_t (*KernelFn)(Position *pos, int n);
+
+typedef enum { FORMAT_TEXT, FORMAT_CSV, FORMAT_JSON } Format;
+
+static uint64_t          g_rng;
+static volatile uint64_t g_sink;   // keeps timed results live
+
+static uint64_t rng_next(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static Cell other(Cell p) {
+    return (p == CELL_A) ? CELL_B : CELL_A;
+}
+
+/* A random playable column, or -1 if the board is full. */
+static int random_column(const Board *b) {
+    int cols[COLS];
+    int n = 0;
+
+    for (int c = 0; c < COLS; c++) {
+        if (board_height(b, c) < ROWS) {
+            cols[n++] = c + 1;
+        }
+    }
+    return n ? cols[rng_next() % (uint64_t)n] : -1;
+}
+
+/*
+ * Undecided positions with 0..ROWS*COLS-1 pieces, from random play that
+ * skips moves ending the game. The chosen column of each position wins
+ * for the side to move about as often as in real play.
+ */
+static void random_positions(Position *pos, int n, uint64_t seed) {
+    g_rng = seed ? seed : 1;
+
+    for (int i = 0; i < n; i++) {
+        Position *p = &pos[i];
+        int plies = (int)(rng_next() % (ROWS * COLS));
+        int tries = 0;
+
+        board_init(&p->board);
+        p->to_move = CELL_A;
+        while (p->board.moves < plies && tries < 64) {
+            int col = random_column(&p->board);
+            int row;
+
+            board_drop(&p->board, col, p->to_move, &row);
+            if (board_is_winning(&p->board, row, col - 1, p->to_move)) {
+                board_undo(&p->board, NULL);
+                tries++;
+                continue;
+            }
+            p->to_move = other(p->to_move);
+            tries      = 0;
+        }
+
+        p->col = random_column(&p->board);
+        p->row = board_height(&p->board, p->col - 1);
+    }
+}
+
+static uint64_t k_drop_undo(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        int row;
+        board_drop(&pos[i].board, pos[i].col, pos[i].to_move, &row);
+        board_undo(&pos[i].board, NULL);
+        sum += (uint64_t)row;
+    }
+    return sum;
+}
+
+static uint64_t k_is_winning(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += board_is_winning(&pos[i].board, pos[i].row, pos[i].col - 1, pos[i].to_move);
+    }
+    return sum;
+}
+
+static uint64_t k_is_full(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += board_is_full(&pos[i].board);
+    }
+    return sum;
+}
+
+static uint64_t k_evaluate(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (uint64_t)(int64_t)evaluate_board(&pos[i].board, pos[i].to_move);
+    }
+    return sum;
+}
+
+static uint64_t k_would_win(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (uint64_t)would_win_if_drop(&pos[i].board, pos[i].col, pos[i].to_move);
+    }
+    return sum;
+}
+
+static uint64_t k_pick_easy_plus(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (uint64_t)bot_pick_easy_plus(&pos[i].board, pos[i].to_move);
+    }
+    return sum;
+}
+
+static uint64_t k_pick_medium(Position *pos, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (uint64_t)bot_pick_medium(&pos[i].board, pos[i].to_move);
+    }
+    return sum;
+}
+
+static const struct {
+    const char *name;
+    KernelFn    fn;
+} KERNELS[] = {
+    { "board_drop+undo",    k_drop_undo },
+    { "board_is_winning",   k_is_winning },
+    { "board_is_full",      k_is_full },
+    { "evaluate_board",     k_evaluate },
+    { "would_win_if_drop",  k_would_win },
+    { "bot_pick_easy_plus", k_pick_easy_plus },
+    { "bot_pick_medium",    k_pick_medium },
+};
+
+#define KERNEL_COUNT ((int)(sizeof(KERNELS) / sizeof(KERNELS[0])))
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+typedef struct {
+    double   median, p99, mean, min;
+    uint64_t checksum;
+} KernelTimes;
+
+/*
+ * Checksum one pass over all positions, warm up, then time 'samples'
+ * batches, walking the positions in order.
+ */
+static void time_kernel(KernelFn fn, Position *pos, int npos, int batch,
+                        int warmup, int samples, double *ns, KernelTimes *out) {
+    int      next = 0;
+    uint64_t sum  = 0;
+
+    out->checksum = fn(pos, npos);
+
+    for (int s = -warmup; s < samples; s++) {
+        if (next + batch > npos) {
+            next = 0;
+        }
+        uint64_t t0 = now_ns();
+        sum += fn(&pos[next], batch);
+        uint64_t t1 = now_ns();
+        next += batch;
+
+        if (s >= 0) {
+            ns[s] = (double)(t1 - t0) / batch;
+        }
+    }
+
+    g_sink = sum;
+
+    double total = 0;
+    for (int s = 0; s < samples; s++) {
+        total += ns[s];
+    }
+    qsort(ns, (size_t)samples, sizeof(*ns), cmp_double);
+
+    int p99 = (samples * 99 + 99) / 100 - 1;   // nearest rank
+    out->median = (samples % 2) ? ns[samples / 2]
+                                : (ns[samples / 2 - 1] + ns[samples / 2]) / 2.0;
+    out->p99    = ns[p99];
+    out->mean   = total / samples;
+    out->min    = ns[0];
+}
+
+static void report(Format fmt, const char *name, const KernelTimes *t) {
+    switch (fmt) {
+        case FORMAT_CSV:
+            printf("%s,%.3f,%.3f,%.3f,%.3f,%llu\n", name, t->median, t->p99,
+                   t->mean, t->min, (unsigned long long)t->checksum);
+            break;
+        case FORMAT_JSON:
+            printf("{\"kernel\":\"%s\",\"median_ns\":%.3f,\"p99_ns\":%.3f,"
+                   "\"mean_ns\":%.3f,\"min_ns\":%.3f,\"checksum\":%llu}\n",
+                   name, t->median, t->p99, t->mean, t->min,
+                   (unsigned long long)t->checksum);
+            break;
+        default:
+            printf("%-20s %9.2f %9.2f %9.2f %9.2f %10.1f  %llu\n", name,
+                   t->median, t->p99, t->mean, t->min,
+                   t->median > 0 ? 1e3 / t->median : 0.0,
+                   (unsigned long long)t->checksum);
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    int      npos    = 4096;
+    int      batch   = 256;
+    int      warmup  = 200;
+    int      samples = 2000;
+    uint64_t seed    = 1;
+    Format   fmt     = FORMAT_TEXT;
+    int      bad     = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            npos = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            samples = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            const char *f = argv[++i];
+            if (strcmp(f, "text") == 0)      fmt = FORMAT_TEXT;
+            else if (strcmp(f, "csv") == 0)  fmt = FORMAT_CSV;
+            else if (strcmp(f, "json") == 0) fmt = FORMAT_JSON;
+            else bad = 1;
+        } else {
+            bad = 1;
+        }
+    }
+    if (bad || npos < 1 || batch < 1 || batch > npos || warmup < 0 || samples < 1) {
+        fprintf(stderr, "usage: %s [-n POSITIONS] [-b BATCH] [-w WARMUP] [-r SAMPLES] "
+                "[-s SEED] [-f text|csv|json]\n", argv[0]);
+        return 2;
+    }
+
+    Position *pos = malloc(sizeof(*pos) * (size_t)npos);
+    double   *ns  = malloc(sizeof(*ns) * (size_t)samples);
+    if (!pos || !ns) {
+        fprintf(stderr, "out of memory\n");
+        free(pos);
+        free(ns);
+        return 1;
+    }
+    random_positions(pos, npos, seed);
+
+    if (fmt == FORMAT_TEXT) {
+        printf("%d positions (seed %llu), batch %d, %d warm-up + %d samples per kernel\n",
+               npos, (unsigned long long)seed, batch, warmup, samples);
+        printf("%-20s %9s %9s %9s %9s %10s  %s\n", "kernel", "median", "p99",
+               "mean", "min", "Mcalls/s", "checksum");
+        printf("%-20s %9s %9s %9s %9s\n", "", "(ns)", "(ns)", "(ns)", "(ns)");
+    } else if (fmt == FORMAT_CSV) {
+        printf("kernel,median_ns,p99_ns,mean_ns,min_ns,checksum\n");
+    }
+
+    for (int k = 0; k < KERNEL_COUNT; k++) {
+        KernelTimes t;
+        time_kernel(KERNELS[k].fn, pos, npos, batch, warmup, samples, ns, &t);
+        report(fmt, KERNELS[k].name, &t);
+    }
+
+    free(pos);
+    free(ns);
+    return 0;
+}
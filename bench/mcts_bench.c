@@ -0,0 +1,104 @@
+// mcts_bench.c
+// Self-play the Monte Carlo engine for one game with a fixed playout
+// budget per move, twice: once keeping the tree between moves and once
+// starting every move from an empty tree. Reports per-move playouts/s,
+// tree size and arena memory, the playouts inherited from the previous
+// move, and the totals of both runs.
+//
+// Usage: mcts_bench [-p PLAYOUTS] [-t THREADS]
+//   -p PLAYOUTS  playouts per move (default 200000)
+//   -t THREADS   search threads (default: one per pool worker)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "mcts.h"
+
+typedef struct {
+    double   ms;
+    uint64_t playouts;
+    uint64_t reused;
+    size_t   peak_bytes;
+    int      moves;
+} GameTotals;
+
+static void self_play(const MctsLimits *limits, int keep_tree, int verbose,
+                      GameTotals *tot) {
+    Board b; board_init(&b);
+    Cell  p = CELL_A;
+
+    memset(tot, 0, sizeof(*tot));
+    mcts_new_game();
+
+    while (!board_is_full(&b)) {
+        if (!keep_tree) {
+            mcts_new_game();
+        }
+
+        MctsResult res;
+        int col = mcts_best_move(&b, p, limits, &res);
+        int r;
+        if (col < 1 || !board_drop(&b, col, p, &r)) {
+            break;
+        }
+
+        if (verbose) {
+            printf("  move %2d: %c plays %d  win %5.1f%%  %9.0f playouts/s  "
+                   "%8zu nodes  %7zu KB  reused %llu\n",
+                   tot->moves + 1, (char)p, col, 100.0 * res.win_rate,
+                   res.playouts_per_sec, res.nodes, res.memory_bytes / 1024,
+                   (unsigned long long)res.reused);
+        }
+
+        tot->ms       += res.elapsed_ms;
+        tot->playouts += res.playouts;
+        tot->reused   += res.reused;
+        if (res.memory_bytes > tot->peak_bytes) {
+            tot->peak_bytes = res.memory_bytes;
+        }
+        tot->moves++;
+
+        if (board_is_winning(&b, r, col - 1, p)) {
+            if (verbose) printf("  %c wins\n", (char)p);
+            return;
+        }
+        p = (p == CELL_A) ? CELL_B : CELL_A;
+    }
+    if (verbose) printf("  draw\n");
+}
+
+static void report(const char *name, const GameTotals *t) {
+    printf("%-10s %3d moves  %8.1f ms  %10.0f playouts/s  reused %llu  peak %zu KB\n",
+           name, t->moves, t->ms, t->ms > 0 ? t->playouts * 1000.0 / t->ms : 0.0,
+           (unsigned long long)t->reused, t->peak_bytes / 1024);
+}
+
+int main(int argc, char **argv) {
+    MctsLimits limits = { 200000, 0, 0, NULL, NULL, false };
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            limits.playouts = (uint64_t)atoll(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            limits.threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-p PLAYOUTS] [-t THREADS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    GameTotals kept, fresh;
+
+    printf("Self-play, %llu playouts per move, tree kept between moves:\n",
+           (unsigned long long)limits.playouts);
+    self_play(&limits, 1, 1, &kept);
+    self_play(&limits, 0, 0, &fresh);
+
+    MctsResult last;
+    if (mcts_last_result(&last)) {
+        printf("arena: %zu KB reserved\n", last.arena_bytes / 1024);
+    }
+    report("kept", &kept);
+    report("fresh", &fresh);
+    return 0;
+}
@@ -0,0 +1,160 @@
+// quiesce_bench.c
+// Measure horizon quiescence: every position of a suite is searched to
+// the same fixed depths with quiescence on and off, from an empty table
+// each time. Reports nodes (and how many of them were forced moves past
+// the horizon), time, and strength: the share of chosen moves that keep
+// the solved outcome of the position (a win stays a win, a draw at
+// least a draw). Position files use the solver_bench format
+// ("<moves> [score]", '#' comments); outcomes come from the solver.
+//
+// Usage: quiesce_bench [-d DEPTH]... FILE...
+//   -d DEPTH  search depth, repeatable (default 4, 6 and 8)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "search.h"
+#include "solver.h"
+
+#define MAX_DEPTHS    16
+#define MAX_POSITIONS 256
+
+typedef struct {
+    Board board;
+    Cell  to_move;
+    int   col_score[COLS];   // solved score of each column
+    int   best_score;
+} Position;
+
+typedef struct {
+    double   ms;
+    uint64_t nodes;
+    uint64_t quiesce_nodes;
+    int      sound;
+} RunTotals;
+
+static int sign(int v) {
+    return (v > 0) - (v < 0);
+}
+
+static void run_one(const Position *p, int depth, bool quiesce, RunTotals *tot) {
+    SearchLimits limits = { depth, 0, 0, 1, NULL, NULL, !quiesce, false };
+    SearchResult res;
+
+    search_new_game();
+    search_best_move(&p->board, p->to_move, &limits, &res);
+
+    tot->ms            += res.stats.elapsed_ms;
+    tot->nodes         += res.stats.nodes;
+    tot->quiesce_nodes += res.stats.quiesce_nodes;
+    if (res.best_col >= 1 &&
+        sign(p->col_score[res.best_col - 1]) == sign(p->best_score)) {
+        tot->sound++;
+    }
+}
+
+/* Load and solve the positions of one file. Returns the count, -1 on error. */
+static int load_file(const char *path, Position *out, int max) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int  n = 0;
+
+    while (n < max && fgets(line, sizeof(line), f)) {
+        char moves[128];
+
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%127s", moves) != 1) continue;
+
+        Position *p = &out[n];
+        board_init(&p->board);
+        int played = board_play_sequence(&p->board, moves);
+        if (played < 0 || played == ROWS * COLS) continue;
+
+        SolverResult sol;
+        p->to_move = (played % 2 == 0) ? CELL_A : CELL_B;
+        if (!solver_solve(&p->board, p->to_move, NULL, &sol)) continue;
+
+        memcpy(p->col_score, sol.col_score, sizeof(p->col_score));
+        p->best_score = sol.score;
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+static void report(const char *name, const RunTotals *t, int positions) {
+    printf("    %-4s: %9.1f ms, %11llu nodes (%5.1f%% past the horizon), "
+           "%3d/%d sound moves\n",
+           name, t->ms, (unsigned long long)t->nodes,
+           t->nodes ? 100.0 * t->quiesce_nodes / t->nodes : 0.0,
+           t->sound, positions);
+}
+
+static int bench_file(const char *path, const int *depths, int ndepths) {
+    static Position positions[MAX_POSITIONS];
+
+    int n = load_file(path, positions, MAX_POSITIONS);
+    if (n < 0) {
+        return -1;
+    }
+
+    printf("%s: %d positions\n", path, n);
+    for (int d = 0; d < ndepths; d++) {
+        RunTotals off = {0, 0, 0, 0}, on = {0, 0, 0, 0};
+
+        for (int i = 0; i < n; i++) {
+            run_one(&positions[i], depths[d], false, &off);
+            run_one(&positions[i], depths[d], true, &on);
+        }
+
+        printf("  depth %d\n", depths[d]);
+        report("off", &off, n);
+        report("on", &on, n);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int depths[MAX_DEPTHS];
+    int ndepths = 0;
+    int files   = 0;
+    int failed  = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc && ndepths < MAX_DEPTHS) {
+            depths[ndepths] = atoi(argv[++i]);
+            if (depths[ndepths++] < 1) {
+                files = -1;
+                break;
+            }
+            continue;
+        }
+        files++;
+    }
+
+    if (files <= 0) {
+        fprintf(stderr, "usage: %s [-d DEPTH]... FILE...\n", argv[0]);
+        return 2;
+    }
+    if (ndepths == 0) {
+        depths[ndepths++] = 4;
+        depths[ndepths++] = 6;
+        depths[ndepths++] = 8;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0) {
+            i++;
+            continue;
+        }
+        if (bench_file(argv[i], depths, ndepths) != 0) {
+            failed = 1;
+        }
+    }
+    return failed;
+}
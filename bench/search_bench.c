@@ -0,0 +1,258 @@
+// search_bench.c
+// Engine benchmark on a position suite grouped by game phase and
+// difficulty (bench/positions/search_suite.txt). Every position is
+// searched by search_best_move() and played by each bot difficulty
+// level; per group it reports the search's nodes, nodes/s and time per
+// position, the levels' time per position, and how often each of them
+// chose a correct column (one that keeps the solved outcome).
+//
+// By default the search runs on the hard level's budget. With -d it
+// instead searches to a fixed depth on one thread from an empty table,
+// so node counts are the same on every run and machine: a changed count
+// means the search itself behaves differently, however noisy the timings.
+//
+// Suite lines are "<phase> <difficulty> <moves> <correct columns>";
+// lines starting with '#' are ignored.
+//
+// Usage: search_bench [-d DEPTH] [-l LEVELS] [-v] FILE...
+//   -d DEPTH   fixed-depth search (default: the hard level's budget)
+//   -l LEVELS  difficulty levels to play, as digits 1-5 (default 12345),
+//              or "none"
+//   -v         one line per position
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "bot.h"
+#include "search.h"
+
+#define MAX_POSITIONS 512
+#define MAX_GROUPS    32
+#define LEVELS        5
+
+typedef struct {
+    char  moves[64];
+    Board board;
+    Cell  to_move;
+    bool  correct[COLS];   // per column (index col-1)
+    int   group;
+} Position;
+
+typedef struct {
+    char     name[32];     // "<phase>/<difficulty>"
+    int      positions;
+    uint64_t nodes;
+    double   search_ms;
+    int      search_ok;
+    double   level_ms[LEVELS];
+    int      level_ok[LEVELS];
+} Group;
+
+static const char *LEVEL_NAMES[LEVELS] = { "easy", "medium", "hard", "perfect", "mcts" };
+
+static Position g_positions[MAX_POSITIONS];
+static int      g_count = 0;
+static Group    g_groups[MAX_GROUPS];
+static int      g_group_count = 0;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static int find_group(const char *phase, const char *difficulty) {
+    char name[32];
+    snprintf(name, sizeof(name), "%s/%s", phase, difficulty);
+
+    for (int g = 0; g < g_group_count; g++) {
+        if (strcmp(g_groups[g].name, name) == 0) {
+            return g;
+        }
+    }
+    if (g_group_count == MAX_GROUPS) {
+        return -1;
+    }
+    memset(&g_groups[g_group_count], 0, sizeof(Group));
+    strcpy(g_groups[g_group_count].name, name);
+    return g_group_count++;
+}
+
+static int load_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int  lineno = 0;
+    while (g_count < MAX_POSITIONS && fgets(line, sizeof(line), f)) {
+        char phase[16], difficulty[16], correct[16];
+        Position *p = &g_positions[g_count];
+
+        lineno++;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%15s %15s %63s %15s", phase, difficulty, p->moves, correct) != 4) {
+            fprintf(stderr, "%s:%d: expected <phase> <difficulty> <moves> <correct columns>\n",
+                    path, lineno);
+            continue;
+        }
+
+        board_init(&p->board);
+        int n = board_play_sequence(&p->board, p->moves);
+        if (n < 0 || n == ROWS * COLS) {
+            fprintf(stderr, "%s:%d: invalid move sequence\n", path, lineno);
+            continue;
+        }
+        p->to_move = (n % 2 == 0) ? CELL_A : CELL_B;
+
+        memset(p->correct, 0, sizeof(p->correct));
+        for (const char *c = correct; *c; c++) {
+            if (*c >= '1' && *c < '1' + COLS) {
+                p->correct[*c - '1'] = true;
+            }
+        }
+
+        p->group = find_group(phase, difficulty);
+        if (p->group >= 0) {
+            g_count++;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static bool is_correct(const Position *p, int col) {
+    return col >= 1 && col <= COLS && p->correct[col - 1];
+}
+
+static void run_position(const Position *p, int depth, const bool *levels, bool verbose) {
+    Group *g = &g_groups[p->group];
+
+    SearchLimits limits = *bot_search_limits(BOT_HARD);
+    if (depth > 0) {
+        limits = (SearchLimits){ .max_depth = depth, .threads = 1 };
+    }
+
+    SearchResult res;
+    search_new_game();
+    search_best_move(&p->board, p->to_move, &limits, &res);
+
+    g->positions++;
+    g->nodes     += res.stats.nodes;
+    g->search_ms += res.stats.elapsed_ms;
+    g->search_ok += is_correct(p, res.best_col);
+
+    if (verbose) {
+        printf("  %-14s %-34s search %d (depth %2d, %10llu nodes, %8.1f ms)%s",
+               g->name, p->moves, res.best_col, res.depth,
+               (unsigned long long)res.stats.nodes, res.stats.elapsed_ms,
+               is_correct(p, res.best_col) ? "" : " wrong");
+    }
+
+    for (int l = 0; l < LEVELS; l++) {
+        if (!levels[l]) continue;
+
+        search_new_game();
+        double t0  = now_ms();
+        int    col = bot_pick_dispatch(&p->board, (BotDifficulty)(l + 1), p->to_move);
+        g->level_ms[l] += now_ms() - t0;
+        g->level_ok[l] += is_correct(p, col);
+
+        if (verbose) {
+            printf(", %s %d%s", LEVEL_NAMES[l], col, is_correct(p, col) ? "" : " wrong");
+        }
+    }
+    if (verbose) {
+        printf("\n");
+    }
+}
+
+static void report(const Group *g, const bool *levels) {
+    int n = g->positions;
+
+    printf("%-16s %3d positions\n", g->name, n);
+    printf("  %-8s: %12llu nodes, %7.2f Mnodes/s, %9.1f ms/position, %3d/%d correct\n",
+           "search", (unsigned long long)g->nodes,
+           g->search_ms > 0 ? (double)g->nodes / g->search_ms / 1e3 : 0.0,
+           n ? g->search_ms / n : 0.0, g->search_ok, n);
+
+    for (int l = 0; l < LEVELS; l++) {
+        if (!levels[l]) continue;
+        printf("  %-8s: %50.1f ms/position, %3d/%d correct\n",
+               LEVEL_NAMES[l], n ? g->level_ms[l] / n : 0.0, g->level_ok[l], n);
+    }
+}
+
+int main(int argc, char **argv) {
+    int  depth   = 0;
+    bool verbose = false;
+    bool levels[LEVELS] = { true, true, true, true, true };
+    int  files   = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+            if (depth < 1) {
+                files = -1;
+                break;
+            }
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            const char *s = argv[++i];
+            memset(levels, 0, sizeof(levels));
+            if (strcmp(s, "none") == 0) continue;
+            for (; *s; s++) {
+                if (*s < '1' || *s >= '1' + LEVELS) {
+                    files = -1;
+                    break;
+                }
+                levels[*s - '1'] = true;
+            }
+            if (files < 0) break;
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else {
+            files++;
+            if (load_file(argv[i]) != 0) {
+                return 1;
+            }
+        }
+    }
+    if (files <= 0) {
+        fprintf(stderr, "usage: %s [-d DEPTH] [-l LEVELS] [-v] FILE...\n", argv[0]);
+        return 2;
+    }
+
+    if (depth > 0) {
+        printf("%d positions, search to depth %d on 1 thread\n", g_count, depth);
+    } else {
+        printf("%d positions, search on the hard level's budget (%d ms, %d threads)\n",
+               g_count, bot_search_limits(BOT_HARD)->time_ms, search_default_threads());
+    }
+
+    for (int i = 0; i < g_count; i++) {
+        run_position(&g_positions[i], depth, levels, verbose);
+    }
+
+    Group total;
+    memset(&total, 0, sizeof(total));
+    strcpy(total.name, "total");
+
+    for (int g = 0; g < g_group_count; g++) {
+        const Group *gr = &g_groups[g];
+        report(gr, levels);
+
+        total.positions += gr->positions;
+        total.nodes     += gr->nodes;
+        total.search_ms += gr->search_ms;
+        total.search_ok += gr->search_ok;
+        for (int l = 0; l < LEVELS; l++) {
+            total.level_ms[l] += gr->level_ms[l];
+            total.level_ok[l] += gr->level_ok[l];
+        }
+    }
+    report(&total, levels);
+    return 0;
+}
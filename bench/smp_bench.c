@@ -0,0 +1,114 @@
+// smp_bench.c
+// Compare single-threaded and Lazy SMP search on a fixed position suite.
+// Every position is searched to a fixed depth twice, from an empty table
+// each time: once on one thread and once on N threads. Reports total
+// time, nodes, move-ordering quality (share of cutoffs on the first move)
+// and the wall-clock speedup per file. Position files use the
+// solver_bench format ("<moves> [score]", '#' comments); scores are ignored.
+//
+// Usage: smp_bench [-d DEPTH] [-t THREADS] FILE...
+//   -d DEPTH    search depth (default 10)
+//   -t THREADS  threads for the parallel run (default: online CPUs)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "board.h"
+#include "search.h"
+
+typedef struct {
+    double   ms;
+    uint64_t nodes;
+    uint64_t cutoffs;
+    uint64_t first_cutoffs;
+} RunTotals;
+
+static void run_one(const Board *b, Cell to_move, int depth, int threads,
+                    RunTotals *tot, int *out_col) {
+    SearchLimits limits = { depth, 0, 0, threads, NULL, NULL, false, false };
+    SearchResult res;
+
+    search_new_game();
+    search_best_move(b, to_move, &limits, &res);
+
+    tot->ms    += res.stats.elapsed_ms;
+    tot->nodes += res.stats.nodes;
+    tot->cutoffs       += res.stats.cutoffs;
+    tot->first_cutoffs += res.stats.first_cutoffs;
+    *out_col    = res.best_col;
+}
+
+static int bench_file(const char *path, int depth, int threads) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char      line[256];
+    int       positions = 0, differ = 0;
+    RunTotals single = {0, 0, 0, 0}, smp = {0, 0, 0, 0};
+
+    while (fgets(line, sizeof(line), f)) {
+        char moves[128];
+
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%127s", moves) != 1) continue;
+
+        Board b; board_init(&b);
+        int n = board_play_sequence(&b, moves);
+        if (n < 0 || n == ROWS * COLS) continue;
+
+        Cell to_move = (n % 2 == 0) ? CELL_A : CELL_B;
+        int  col1, colN;
+        run_one(&b, to_move, depth, 1, &single, &col1);
+        run_one(&b, to_move, depth, threads, &smp, &colN);
+
+        positions++;
+        if (col1 != colN) {
+            differ++;
+        }
+    }
+    fclose(f);
+
+    printf("%s: %d positions, depth %d\n", path, positions, depth);
+    printf("  1 thread  : %9.1f ms, %12llu nodes, %.2f Mnodes/s, "
+           "%.1f%% first-move cutoffs\n",
+           single.ms, (unsigned long long)single.nodes,
+           single.ms > 0 ? (double)single.nodes / single.ms / 1e3 : 0.0,
+           single.cutoffs ? 100.0 * single.first_cutoffs / single.cutoffs : 0.0);
+    printf("  %d threads: %9.1f ms, %12llu nodes, %.2f Mnodes/s\n",
+           threads, smp.ms, (unsigned long long)smp.nodes,
+           smp.ms > 0 ? (double)smp.nodes / smp.ms / 1e3 : 0.0);
+    printf("  speedup %.2fx, %d/%d best moves differ\n",
+           smp.ms > 0 ? single.ms / smp.ms : 0.0, differ, positions);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int depth   = 10;
+    int threads = search_default_threads();
+    int files   = 0;
+    int failed  = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+            continue;
+        }
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+            continue;
+        }
+        files++;
+        if (bench_file(argv[i], depth, threads) != 0) {
+            failed = 1;
+        }
+    }
+
+    if (files == 0 || depth < 1 || threads < 1) {
+        fprintf(stderr, "usage: %s [-d DEPTH] [-t THREADS] FILE...\n", argv[0]);
+        return 2;
+    }
+    return failed;
+}
@@ -0,0 +1,107 @@
+// solver_bench.c
+// Solve every position of one or more test files and report accuracy and
+// throughput. Each line is "<moves> [score]": a 1-based column sequence
+// (A first) and optionally the expected solver score for the side to move,
+// the format of the usual Connect 4 solver test sets. Lines starting with
+// '#' are ignored.
+//
+// Usage: solver_bench [--keep-tt] FILE...
+//   --keep-tt  do not clear the solver table between positions
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "solver.h"
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static int bench_file(const char *path, int keep_tt) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char     line[256];
+    int      positions = 0, checked = 0, wrong = 0, invalid = 0;
+    uint64_t nodes = 0;
+    double   total_ms = 0;
+
+    while (fgets(line, sizeof(line), f)) {
+        char moves[128];
+        int  expected;
+
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        int fields = sscanf(line, "%127s %d", moves, &expected);
+        if (fields < 1) continue;
+
+        Board b; board_init(&b);
+        int n = board_play_sequence(&b, moves);
+        if (n < 0 || n == ROWS * COLS) {
+            invalid++;
+            continue;
+        }
+
+        if (!keep_tt) {
+            solver_reset();
+        }
+
+        Cell     to_move = (n % 2 == 0) ? CELL_A : CELL_B;
+        int      score;
+        uint64_t pos_nodes;
+        double   t0 = now_ms();
+        solver_score(&b, to_move, NULL, &score, &pos_nodes);
+        total_ms += now_ms() - t0;
+        nodes    += pos_nodes;
+        positions++;
+
+        if (fields == 2) {
+            checked++;
+            if (score != expected) {
+                wrong++;
+                printf("MISMATCH %s: got %d, expected %d\n", moves, score, expected);
+            }
+        }
+    }
+    fclose(f);
+
+    double secs = total_ms / 1000.0;
+    printf("%s: %d positions (%d checked, %d wrong, %d skipped), "
+           "mean %.3f ms, mean %.0f nodes, %.1f positions/s, %.2f Mnodes/s\n",
+           path, positions, checked, wrong, invalid,
+           positions ? total_ms / positions : 0.0,
+           positions ? (double)nodes / positions : 0.0,
+           secs > 0 ? positions / secs : 0.0,
+           secs > 0 ? (double)nodes / secs / 1e6 : 0.0);
+
+    return wrong;
+}
+
+int main(int argc, char **argv) {
+    int keep_tt = 0;
+    int files   = 0;
+    int failed  = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--keep-tt") == 0) {
+            keep_tt = 1;
+            continue;
+        }
+        files++;
+        if (bench_file(argv[i], keep_tt) != 0) {
+            failed = 1;
+        }
+    }
+
+    if (files == 0) {
+        fprintf(stderr, "usage: %s [--keep-tt] FILE...\n", argv[0]);
+        return 2;
+    }
+    return failed;
+}
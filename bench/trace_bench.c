@@ -0,0 +1,172 @@
+// trace_bench.c
+// Cost of the trace points of include/trace.h on the search. Searches a
+// position suite to a fixed depth on one thread, several rounds, and
+// reports the median round time and nodes/s.
+//
+// Built with TRACE=1 it alternates rounds with recording paused and
+// recording on, and also times trace_event() alone. Built without it the
+// trace points are compiled out; compare its numbers with a TRACE=1 build:
+//   make clean && make bench-trace && make clean && make TRACE=1 bench-trace
+// Position files use the solver_bench format ("<moves> [score]", '#' comments).
+//
+// Usage: trace_bench [-d DEPTH] [-r ROUNDS] FILE...
+//   -d DEPTH   search depth (default 10)
+//   -r ROUNDS  rounds per mode (default 5)
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "board.h"
+#include "search.h"
+#include "trace.h"
+
+#define MAX_POSITIONS 1024
+#define MAX_ROUNDS    64
+
+typedef struct {
+    Board board;
+    Cell  to_move;
+} Position;
+
+static Position g_positions[MAX_POSITIONS];
+static int      g_count = 0;
+
+#ifdef CONNECT4_TRACE
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+#endif
+
+static int load_file(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    while (g_count < MAX_POSITIONS && fgets(line, sizeof(line), f)) {
+        char moves[128];
+
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%127s", moves) != 1) continue;
+
+        Position *p = &g_positions[g_count];
+        board_init(&p->board);
+        int n = board_play_sequence(&p->board, moves);
+        if (n < 0 || n == ROWS * COLS) continue;
+
+        p->to_move = (n % 2 == 0) ? CELL_A : CELL_B;
+        g_count++;
+    }
+    fclose(f);
+    return 0;
+}
+
+/* One pass over the suite; returns its time, adds its nodes to *nodes. */
+static double run_round(int depth, uint64_t *nodes) {
+    SearchLimits limits = { depth, 0, 0, 1, NULL, NULL, false, false };
+    double       ms     = 0;
+
+    for (int i = 0; i < g_count; i++) {
+        SearchResult res;
+        search_new_game();
+        search_best_move(&g_positions[i].board, g_positions[i].to_move, &limits, &res);
+        ms     += res.stats.elapsed_ms;
+        *nodes += res.stats.nodes;
+    }
+    return ms;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, int n) {
+    qsort(v, (size_t)n, sizeof(*v), cmp_double);
+    return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2.0;
+}
+
+static void report(const char *name, double ms, uint64_t nodes_per_round) {
+    printf("  %-22s: %9.2f ms per round, %.2f Mnodes/s\n", name, ms,
+           ms > 0 ? (double)nodes_per_round / ms / 1e3 : 0.0);
+}
+
+int main(int argc, char **argv) {
+    int depth  = 10;
+    int rounds = 5;
+    int files  = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else {
+            files++;
+            if (load_file(argv[i]) != 0) {
+                return 1;
+            }
+        }
+    }
+    if (files == 0 || depth < 1 || rounds < 1 || rounds > MAX_ROUNDS) {
+        fprintf(stderr, "usage: %s [-d DEPTH] [-r ROUNDS] FILE...\n", argv[0]);
+        return 2;
+    }
+
+    uint64_t nodes = 0;
+    run_round(depth, &nodes);   // warm-up
+    nodes = 0;
+    run_round(depth, &nodes);   // nodes per round (fixed depth: the same every round)
+
+    printf("%d positions, depth %d, %d rounds, %llu nodes per round\n",
+           g_count, depth, rounds, (unsigned long long)nodes);
+
+#ifdef CONNECT4_TRACE
+    double   off[MAX_ROUNDS], on[MAX_ROUNDS];
+    uint64_t unused = 0;
+    uint64_t events = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        trace_set_enabled(false);
+        off[r] = run_round(depth, &unused);
+        trace_set_enabled(true);
+
+        uint64_t before = trace_event_count();
+        on[r]  = run_round(depth, &unused);
+        events = trace_event_count() - before;
+    }
+
+    const int calls = 1000000;
+    double    t0    = now_ms();
+    for (int i = 0; i < calls; i++) {
+        TRACE_INSTANT("bench", i);
+    }
+    double ns_per_event = (now_ms() - t0) * 1e6 / calls;
+
+    double m_off = median(off, rounds);
+    double m_on  = median(on, rounds);
+    report("compiled in, paused", m_off, nodes);
+    report("compiled in, recording", m_on, nodes);
+    printf("  measured overhead      : %+.2f%% (median of rounds, includes noise)\n",
+           m_off > 0 ? 100.0 * (m_on - m_off) / m_off : 0.0);
+    printf("  trace_event()          : %.1f ns x %llu events per round = %.3f ms (%.2f%%)\n",
+           ns_per_event, (unsigned long long)events, ns_per_event * events / 1e6,
+           m_off > 0 ? 100.0 * ns_per_event * events / 1e6 / m_off : 0.0);
+#else
+    double   times[MAX_ROUNDS];
+    uint64_t unused = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        times[r] = run_round(depth, &unused);
+    }
+    report("compiled out", median(times, rounds), nodes);
+#endif
+    return 0;
+}
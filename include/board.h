@@ -2,6 +2,7 @@
 #define BOARD_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /*
  * Basic board settings for Connect 4.
@@ -9,6 +10,13 @@
 #define ROWS 6
 #define COLS 7
 
+/*
+ * Bits per column in a bitboard: ROWS playable bits plus one
+ * always-empty sentinel bit on top, so shifts never wrap into
+ * the next column.
+ */
+#define BOARD_H1 (ROWS + 1)
+
 /*
  * Cell state on the board.
  * Values match what is printed.
@@ -19,16 +27,168 @@ typedef enum {
     CELL_B     = 'B'
 } Cell;
 
+/*
+ * Bitboard: one bit per cell, column-major.
+ * Bit (c * BOARD_H1 + h) is column c (0-based, left to right),
+ * height h (0 = bottom row).
+ */
+typedef uint64_t Bitboard;
+
+/*
+ * Bitboard constants.
+ *   BOARD_BOTTOM_MASK : lowest cell of every column
+ *   BOARD_FULL_MASK   : every playable cell (sentinel bits excluded)
+ */
+#define BOARD_BOTTOM_MASK ((Bitboard)0x0040810204081ULL)
+#define BOARD_FULL_MASK   (BOARD_BOTTOM_MASK * ((((Bitboard)1) << ROWS) - 1))
+
+_Static_assert(ROWS == 6 && COLS == 7, "BOARD_BOTTOM_MASK is laid out for a 7x6 board");
+
+/* Four-cell windows on the board (horizontal, vertical, two diagonals). */
+#define BOARD_WINDOWS (ROWS * (COLS - 3) + COLS * (ROWS - 3) + 2 * (ROWS - 3) * (COLS - 3))
+
 /*
  * Board:
- *  - grid  : pieces on the board
- *  - heights[c] : how many pieces are in column c (0..ROWS)
+ *  - stones[0] : cells holding a CELL_A piece
+ *  - stones[1] : cells holding a CELL_B piece
+ *  - moves     : number of pieces played (depth of the move stack)
+ *  - history   : 0-based column of every piece played, oldest first
+ *
+ * Column heights and cell contents are derived from the two words;
+ * use board_height() and board_cell() instead of reading bits directly.
+ * The move stack lets board_undo() take back moves in place, so search
+ * code can play/undo on one board instead of copying it per move.
+ * Anything derived from the pieces (Zobrist keys, the incremental
+ * evaluation) is kept next to the board by the code that needs it.
  */
 typedef struct {
-    Cell grid[ROWS][COLS];
-    int  heights[COLS];
+    Bitboard stones[2];
+    int      moves;
+    int8_t   history[ROWS * COLS];
 } Board;
 
+/* Index into Board.stones for a player piece. */
+static inline int board_player_index(Cell p) {
+    return p == CELL_B;
+}
+
+/* Bits of all playable cells in column c (0-based). */
+static inline Bitboard board_column_mask(int c) {
+    return ((((Bitboard)1) << ROWS) - 1) << (c * BOARD_H1);
+}
+
+/* Bit of the cell at row r (0 = top, as printed) and column c (0-based). */
+static inline Bitboard board_cell_bit(int r, int c) {
+    return ((Bitboard)1) << (c * BOARD_H1 + (ROWS - 1 - r));
+}
+
+/* All occupied cells. */
+static inline Bitboard board_mask(const Board *b) {
+    return b->stones[0] | b->stones[1];
+}
+
+/* Number of pieces in column c (0-based), 0..ROWS. */
+static inline int board_height(const Board *b, int c) {
+    return __builtin_popcountll(board_mask(b) & board_column_mask(c));
+}
+
+/* Piece at row r (0 = top) and column c (0-based). */
+static inline Cell board_cell(const Board *b, int r, int c) {
+    Bitboard bit = board_cell_bit(r, c);
+    if (b->stones[0] & bit) return CELL_A;
+    if (b->stones[1] & bit) return CELL_B;
+    return CELL_EMPTY;
+}
+
+/*
+ * Unique key of the piece layout (49 bits): in each column, the bit just
+ * above the top piece plus the CELL_A pieces below it. Two boards have
+ * the same key exactly when they hold the same pieces.
+ */
+static inline uint64_t board_key(const Board *b) {
+    return b->stones[0] + board_mask(b) + BOARD_BOTTOM_MASK;
+}
+
+/*
+ * Zobrist code of a piece of player index p (0 = A, 1 = B) on bitboard
+ * bit 'bit'. Codes come from a fixed mixing function, so keys are the
+ * same in every process and need no table to be initialised.
+ */
+static inline uint64_t board_zobrist(int p, int bit) {
+    uint64_t z = 0x9E3779B97F4A7C15ULL * (uint64_t)(p * 64 + bit + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Bitboard bit of the most recent piece on b (b must not be empty). */
+static inline int board_last_bit(const Board *b) {
+    int c = b->history[b->moves - 1];
+    return c * BOARD_H1 + board_height(b, c) - 1;
+}
+
+/*
+ * Zobrist code of the most recent piece on b (b must not be empty).
+ * A key kept next to the board is updated by XOR-ing this in right
+ * after board_drop() and right before board_undo().
+ */
+static inline uint64_t board_last_zobrist(const Board *b) {
+    int bit = board_last_bit(b);
+    return board_zobrist((int)((b->stones[1] >> bit) & 1), bit);
+}
+
+/* Cells where a piece would land right now (one per non-full column). */
+static inline Bitboard board_playable(Bitboard mask) {
+    return (mask + BOARD_BOTTOM_MASK) & BOARD_FULL_MASK;
+}
+
+/*
+ * Empty cells that would complete a four for 'stones', given the
+ * occupied cells 'mask'. The cells need not be playable yet; AND with
+ * board_playable() for wins available on the next move.
+ */
+Bitboard board_winning_cells(Bitboard stones, Bitboard mask);
+
+/*
+ * ThreatMap
+ * ---------
+ * Immediate threats of both players, indexed by board_player_index():
+ *  - cells[p] : empty cells that would complete a four for p
+ *  - now[p]   : those of them p can drop into on the next move
+ *  - playable : cells where a piece would land right now
+ */
+typedef struct {
+    Bitboard cells[2];
+    Bitboard now[2];
+    Bitboard playable;
+} ThreatMap;
+
+static inline void board_threat_map(const Board *b, ThreatMap *tm) {
+    Bitboard mask = board_mask(b);
+    tm->playable  = board_playable(mask);
+    for (int p = 0; p < 2; p++) {
+        tm->cells[p] = board_winning_cells(b->stones[p], mask);
+        tm->now[p]   = tm->cells[p] & tm->playable;
+    }
+}
+
+/* 0-based column of the lowest set bit of x (x must not be 0). */
+static inline int board_bit_column(Bitboard x) {
+    return __builtin_ctzll(x) / BOARD_H1;
+}
+
+/* Left-right mirror image of a bitboard (column c <-> COLS-1-c). */
+Bitboard board_mirror(Bitboard x);
+
+/* Zobrist keys of b's pieces and of their mirror image, from scratch. */
+void board_compute_keys(const Board *b, uint64_t *out_key, uint64_t *out_mirror_key);
+
+/*
+ * Key shared by a position and its mirror image (the smaller of the
+ * two Zobrist keys), for caches that treat both as one.
+ */
+uint64_t board_canonical_key(const Board *b);
+
 /*
  * Set board to empty (no pieces, all heights = 0).
  */
@@ -43,6 +203,14 @@ void board_init(Board *b);
  */
 bool board_drop(Board *b, int col1_based, Cell piece, int *out_row);
 
+/*
+ * Take back the most recent board_drop().
+ * If out_col1_based != NULL, stores the column (1..COLS) of the removed
+ * piece there.
+ * Returns true on success, false if the board is empty.
+ */
+bool board_undo(Board *b, int *out_col1_based);
+
 /*
  * Check if piece at (r, c) makes a 4-in-a-row.
  * Returns true if this is a winning move.
@@ -54,10 +222,19 @@ bool board_is_winning(const Board *b, int r, int c, Cell piece);
  */
 bool board_is_full(const Board *b);
 
+/*
+ * Play a move sequence such as "4453", one digit 1..COLS per move,
+ * alternating players. CELL_A moves first when the board holds an even
+ * number of pieces, CELL_B otherwise.
+ * Returns the number of moves played, or -1 if a character is not a
+ * column, a column is full, or a move ends the game before the last one.
+ * On failure the board holds the moves before the bad one.
+ */
+int board_play_sequence(Board *b, const char *seq);
+
 /*
  * Print the board to stdout in a simple text grid.
  */
 void board_print(const Board *b);
 
 #endif /* BOARD_H */
-
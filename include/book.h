@@ -0,0 +1,86 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+
+/*
+ * Opening book: solved scores (solver.h convention) of every position
+ * up to max_ply pieces, stored once per left-right mirror pair.
+ *
+ * File layout (little-endian, as written by book_write()):
+ *   BookHeader
+ *   uint64_t entries[count], ascending: (canonical key << 8) | (uint8_t)score
+ *
+ * The file is mmapped read-only; a probe is a binary search.
+ */
+
+#define BOOK_MAGIC        "C4BOOK1"
+#define BOOK_DEFAULT_PATH "data/opening.book"
+
+typedef struct {
+    char     magic[8];   // BOOK_MAGIC, NUL-padded
+    uint32_t max_ply;
+    uint32_t reserved;
+    uint64_t count;
+} BookHeader;
+
+typedef struct {
+    const uint64_t *entries;
+    size_t          count;
+    int             max_ply;
+    void           *map;      // mmapped file, NULL if not open
+    size_t          map_len;
+} OpeningBook;
+
+/*
+ * Canonical key of the position with 'to_move' to play: the smaller of
+ * the exact keys of the position and of its mirror image.
+ */
+uint64_t book_key(const Board *b, Cell to_move);
+
+/* Map a book file. Returns 0 on success, -1 if missing or malformed. */
+int book_open(OpeningBook *bk, const char *path);
+
+/* Unmap the book. */
+void book_close(OpeningBook *bk);
+
+/* Solved score of the position for 'to_move', if it is in the book. */
+bool book_probe(const OpeningBook *bk, const Board *b, Cell to_move, int *out_score);
+
+/*
+ * Book scores of every column for 'to_move' (index col-1, from the
+ * mover's view, SOLVER_INVALID for full columns). Works for positions
+ * with fewer than max_ply pieces. Returns false if any child is missing.
+ */
+bool book_column_scores(const OpeningBook *bk, const Board *b, Cell to_move,
+                        int col_score[COLS]);
+
+/*
+ * Best column (1..COLS) for 'to_move' from the book scores of all
+ * children, preferring central columns on ties. Works for positions
+ * with fewer than max_ply pieces. Returns false if any child is missing.
+ */
+bool book_best_move(const OpeningBook *bk, const Board *b, Cell to_move,
+                    int *out_col, int *out_score);
+
+/*
+ * Sort count entries in place and write a book file.
+ * Returns 0 on success, -1 on I/O error.
+ */
+int book_write(const char *path, int max_ply, uint64_t *entries, size_t count);
+
+/* Pack one book entry. */
+static inline uint64_t book_entry(uint64_t key, int score) {
+    return (key << 8) | (uint8_t)(int8_t)score;
+}
+
+/*
+ * Process-wide book, mapped on first use from CONNECT4_BOOK or
+ * BOOK_DEFAULT_PATH. Returns NULL if no book file is available.
+ */
+const OpeningBook *book_default(void);
+
+#endif /* BOOK_H */
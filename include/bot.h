@@ -0,0 +1,153 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "board.h"
+#include "mcts.h"
+#include "pool.h"
+#include "search.h"
+#include "solver.h"
+
+/*
+ * BotDifficulty
+ * -------------
+ * Difficulty levels for the bot.
+ */
+typedef enum {
+    BOT_EASY   = 1,
+    BOT_MEDIUM = 2,
+    BOT_HARD    = 3,
+    BOT_PERFECT = 4,  // exact solver, hard search if the solve runs over budget
+    BOT_MCTS    = 5   // Monte Carlo tree search (mcts.h)
+} BotDifficulty;
+
+/*
+ * Search budget of a difficulty level, or NULL for levels that do not
+ * search (easy and medium play from fixed rules).
+ */
+const SearchLimits *bot_search_limits(BotDifficulty d);
+
+/* Budget of the exact solver used by the perfect level and hints. */
+const SolverLimits *bot_solver_limits(void);
+
+/* Budget of the Monte Carlo level. */
+const MctsLimits *bot_mcts_limits(void);
+
+/*
+ * Bot move pickers. Each returns a column 1..COLS, or -1 if the board
+ * is full. The easy and medium levels read everything from one
+ * ThreatMap (board.h) and never play a move.
+ */
+int bot_pick_easy_plus(const Board *b, Cell bot_player);
+int bot_pick_medium(const Board *b, Cell bot_player);
+int bot_pick_hard(const Board *b, Cell bot_player);
+int bot_pick_perfect(const Board *b, Cell bot_player);
+int bot_pick_mcts(const Board *b, Cell bot_player);
+int bot_pick_dispatch(const Board *b, BotDifficulty d, Cell bot_player);
+
+/* Score of a column that cannot be played in a ColumnRanking. */
+#define BOT_NO_SCORE SEARCH_NO_SCORE
+
+/*
+ * ColumnRanking
+ * -------------
+ * Every legal column of one position, scored by bot_rank_columns().
+ *  - exact     : the scores are solved (solver.h convention, from the
+ *                book or the solver); otherwise they are search scores
+ *                (search.h, forced results beyond +/-WIN_SCORE/2)
+ *  - col_score : score of each column (index col-1) for the side to
+ *                move, BOT_NO_SCORE for full columns
+ *  - col_plies : plies until the game ends after each column: with best
+ *                play when exact, otherwise until the forced win or
+ *                loss (0 if the search found none)
+ *  - best_col  : highest-scoring column 1..COLS (central on ties),
+ *                -1 if the board is full
+ *  - depth     : search depth of a non-exact ranking
+ *  - cached    : served from the ranking cache without searching
+ */
+typedef struct {
+    bool exact;
+    int  col_score[COLS];
+    int  col_plies[COLS];
+    int  best_col;
+    int  depth;
+    bool cached;
+} ColumnRanking;
+
+/*
+ * bot_rank_columns
+ * ----------------
+ * Score all legal columns for 'to_move' in one pass: from the opening
+ * book, else the exact solver within bot_solver_limits(), else a
+ * multi-PV search (search_rank_columns()) within the hard level's
+ * budget. Rankings are cached per position (mirror images share an
+ * entry), so asking again is free. The perfect level picks its move
+ * from a cached exact ranking instead of solving; the hard level does
+ * so from an exact one or one searched as deep as it would search,
+ * after checking for immediate wins and blocks. Returns out->best_col.
+ */
+int bot_rank_columns(const Board *b, Cell to_move, ColumnRanking *out);
+
+/*
+ * BotSearch
+ * ---------
+ * A bot move computed on the engine pool while the caller stays free.
+ *
+ *   bot_search_start(&s, b, d, player);   // returns at once
+ *   while (!bot_search_poll(&s)) { ... read s.progress ... }
+ *   col = bot_search_wait(&s);
+ *
+ * bot_search_stop() asks a running search to finish now: the searching
+ * levels return their best move so far within microseconds (the first
+ * legal central column if not even depth 1 completed). 'progress' is
+ * updated as the search deepens; levels that do not search publish
+ * their move once at the end. The struct must stay in place until
+ * bot_search_wait() has returned.
+ *
+ * Fields other than 'progress' are for reading after the wait:
+ *  - result_col : the move (1..COLS), or -1 if the board is full
+ *  - ranking    : hints, and BOT_PERFECT when the book or the solver
+ *                 decided the move: every column's score
+ *                 (ranking.best_col == -1 otherwise)
+ *  - stats      : counters of the search that decided the move (a
+ *                 solve fills only nodes, threads and elapsed_ms); all
+ *                 zero when nothing searched (book moves, immediate wins
+ *                 and blocks, cached rankings, easy, medium and MCTS)
+ *
+ * bot_hint_start() runs bot_rank_columns() the same way; its
+ * result_col is the ranking's best column.
+ */
+typedef struct {
+    Board          snapshot;
+    BotDifficulty  diff;
+    Cell           player;
+    atomic_bool    stop;
+    SearchProgress progress;
+    bool           hint;
+    ColumnRanking  ranking;
+    SearchStats    stats;
+    int            result_col;
+    ThreadPool    *pool;      // NULL: ran inline in bot_search_start()
+    PoolTask       task;
+} BotSearch;
+
+void bot_search_start(BotSearch *s, const Board *b, BotDifficulty d, Cell bot_player);
+void bot_hint_start(BotSearch *s, const Board *b, Cell to_move);
+
+/* True once the move is known; never blocks. */
+bool bot_search_poll(const BotSearch *s);
+
+/* Block until the move is known and return it. */
+int bot_search_wait(BotSearch *s);
+
+/* Ask the search to return its best move so far; does not wait. */
+void bot_search_stop(BotSearch *s);
+
+/* Would dropping p in column col (1..COLS) win? The board is not modified. */
+int would_win_if_drop(const Board *b, int col, Cell p);
+
+/* Immediate win for p? Return column 1..COLS or -1. */
+int find_self_win_in_1(const Board *b, Cell p);
+
+#endif /* BOT_H */
@@ -0,0 +1,91 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "board.h"
+
+/*
+ * evaluate_board
+ * --------------
+ * Heuristic score of the position from the view of 'me':
+ * center-column control plus every four-cell window that only one
+ * player can still complete. Positive = good for 'me'.
+ *
+ * Computed from the bitboards with no data-dependent branches: window
+ * counts come from a bitboard kernel (AVX2 when the CPU has it,
+ * portable scalar otherwise, chosen at runtime) and scores from a
+ * lookup table. Code that plays and undoes moves keeps an EvalState
+ * instead, so a leaf costs a read.
+ */
+int evaluate_board_scan(const Board *b, Cell me);
+
+static inline int evaluate_board(const Board *b, Cell me) {
+    return evaluate_board_scan(b, me);
+}
+
+/* The original cell-by-cell scan (eval_window per window). For tests. */
+int evaluate_board_reference(const Board *b, Cell me);
+
+/*
+ * Window-count kernels behind evaluate_board_scan(). n[p][k] is the
+ * number of windows holding exactly k pieces of player index p
+ * (0 = A in 'a', 1 = B in 'b') and none of the other's, k = 1..4.
+ */
+typedef struct {
+    int n[2][5];
+} EvalCounts;
+
+typedef void (*EvalCountFn)(Bitboard a, Bitboard b, EvalCounts *out);
+
+/* Kernel by name ("scalar", "avx2"), or NULL if this CPU lacks it. */
+EvalCountFn eval_count_kernel(const char *name);
+
+/* Name of the kernel evaluate_board_scan() uses on this CPU. */
+const char *eval_count_kernel_name(void);
+
+/*
+ * Window weights from eval_window(): own[k] for a window with k pieces
+ * of the scored player and none of the opponent's, opp[k] for k of the
+ * opponent's and none of the player's (k = 0..4; index 0 is 0).
+ */
+void eval_window_weights(int own[5], int opp[5]);
+
+/* Score per center-column piece (own pieces add, opponent's subtract). */
+#define EVAL_CENTER 6
+
+/*
+ * Score for player index p from kernel counts and the center-column
+ * pieces of p (center_own) and of the opponent (center_opp).
+ */
+int eval_score_counts(const EvalCounts *c, Bitboard center_own,
+                      Bitboard center_opp, int p);
+
+/*
+ * EvalState
+ * ---------
+ * evaluate_board() kept up to date across drops and undos:
+ *  - window_count : pieces per window, per player index
+ *  - score        : evaluate_board() per player index
+ *
+ * eval_state_push() follows a board_drop() and eval_state_pop()
+ * precedes the matching board_undo(); each rescores only the windows
+ * through the piece's cell.
+ */
+typedef struct {
+    uint8_t window_count[2][BOARD_WINDOWS];
+    int32_t score[2];
+} EvalState;
+
+/* State of b's current pieces. */
+void eval_state_init(EvalState *e, const Board *b);
+
+/* Add b's most recent piece (call right after board_drop()). */
+void eval_state_push(EvalState *e, const Board *b);
+
+/* Remove b's most recent piece (call right before board_undo()). */
+void eval_state_pop(EvalState *e, const Board *b);
+
+static inline int eval_state_score(const EvalState *e, Cell me) {
+    return e->score[board_player_index(me)];
+}
+
+#endif /* EVAL_H */
@@ -2,6 +2,7 @@
 #define GAME_H
 
 #include "board.h"
+#include "bot.h"
 
 #define MAX_MOVES           42  // 6 * 7
 #define MAX_UNDO_PER_PLAYER 3
@@ -17,17 +18,6 @@ typedef enum {
     MODE_ONLINE= 3   // Reserved for online mode
 } GameMode;
 
-/*
- * BotDifficulty
- * -------------
- * Difficulty levels for the bot.
- */
-typedef enum {
-    BOT_EASY   = 1,
-    BOT_MEDIUM = 2,
-    BOT_HARD   = 3   // Reserved for later
-} BotDifficulty;
-
 /*
  * game_run
  * --------
@@ -0,0 +1,103 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "search.h"    // SearchProgress
+
+/*
+ * Monte Carlo Tree Search engine (UCT), an alternative to the
+ * alpha-beta search in search.h.
+ *
+ * Nodes live in a preallocated arena and are never freed one by one.
+ * The tree survives between calls: when the next position is the root,
+ * a child or a grandchild of the previous search (the bot's move and
+ * the reply), that subtree is compacted into the second arena and the
+ * search continues from it.
+ */
+
+/* Default arena size in megabytes (CONNECT4_MCTS_MB overrides it). */
+#define MCTS_DEFAULT_ARENA_MB 64
+
+/* Playout budget used when a call sets no budget and no cancel flag. */
+#define MCTS_DEFAULT_PLAYOUTS 100000
+
+/*
+ * MctsLimits
+ * ----------
+ * Budget for one move; zero means "no limit" for each field.
+ *  - playouts : playouts to run in this call (all threads)
+ *  - time_ms  : wall-clock budget
+ *  - threads  : search threads; 0 = one per worker of pool_default()
+ *  - cancel   : optional flag another thread sets to stop the search
+ *  - progress : optional, receives the most visited column as it changes
+ *  - no_record: do not keep the result for mcts_last_result(), so a
+ *               background search such as the ponder does not replace
+ *               the figures of the last move played
+ *
+ * With neither a playout nor a time budget, a search with a cancel
+ * flag runs until it is cancelled; one without stops after
+ * MCTS_DEFAULT_PLAYOUTS.
+ */
+typedef struct {
+    uint64_t        playouts;
+    int             time_ms;
+    int             threads;
+    atomic_bool    *cancel;
+    SearchProgress *progress;
+    bool            no_record;
+} MctsLimits;
+
+/*
+ * MctsResult
+ * ----------
+ * Outcome of mcts_best_move().
+ *  - best_col         : most visited column 1..COLS, or -1 if the board is full
+ *  - win_rate         : its average result for the mover (win 1, draw 0.5)
+ *  - playouts         : playouts run by this call
+ *  - reused           : playouts inherited from the previous tree
+ *  - nodes            : nodes in the tree after the search
+ *  - memory_bytes     : arena memory those nodes occupy
+ *  - arena_bytes      : memory reserved for both arenas
+ *  - elapsed_ms       : wall-clock time spent
+ *  - playouts_per_sec : playouts / elapsed time
+ */
+typedef struct {
+    int      best_col;
+    double   win_rate;
+    uint64_t playouts;
+    uint64_t reused;
+    size_t   nodes;
+    size_t   memory_bytes;
+    size_t   arena_bytes;
+    double   elapsed_ms;
+    double   playouts_per_sec;
+} MctsResult;
+
+/*
+ * mcts_best_move
+ * --------------
+ * UCT search for 'to_move' on b. Threads descend the shared tree in
+ * parallel, counting their visit on the way down so that others see a
+ * virtual loss and spread out; each leaf is settled by one random
+ * playout that takes immediate wins and blocks the opponent's. A leaf
+ * gets its children after a few visits, which keeps the arena small.
+ * When the arena fills up, leaves stop being expanded and the search
+ * continues on the existing tree.
+ *
+ * out may be NULL. Returns the chosen column (1..COLS) or -1.
+ */
+int mcts_best_move(const Board *b, Cell to_move, const MctsLimits *limits,
+                   MctsResult *out);
+
+/* Drop the kept tree (call when a new game starts). */
+void mcts_new_game(void);
+
+/* Result of the most recent mcts_best_move() without no_record; false
+   if none has run. */
+bool mcts_last_result(MctsResult *out);
+
+#endif /* MCTS_H */
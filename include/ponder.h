@@ -0,0 +1,71 @@
+#ifndef PONDER_H
+#define PONDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "board.h"
+#include "bot.h"
+
+/*
+ * Pondering: searching on the opponent's time.
+ *
+ * While the opponent thinks, one background task on the engine pool
+ * works on the position with the opponent to move, so the engine's
+ * next search starts from that work instead of from zero:
+ *  - BOT_MCTS grows the kept Monte Carlo tree from the opponent's
+ *    position; the reply actually played is a child of its root, and
+ *    the next mcts_best_move() continues from that subtree.
+ *  - BOT_HARD searches the engine's answer to each legal reply, most
+ *    likely first (immediate wins and forced blocks first, then by
+ *    evaluation), one ply deeper per round. The results land in the
+ *    shared transposition table, where the next search finds them.
+ *  - BOT_PERFECT solves the engine's answer to each likely reply with
+ *    the exact solver, within the level's solver budget, so its move
+ *    (and hints) find the results in the solver's table. If a solve
+ *    runs over budget the real move will too and fall back to the hard
+ *    search, so the ponder continues the BOT_HARD way.
+ *  - Easy and medium levels do not search, so they do not ponder.
+ *
+ * There is one ponder at a time per process.
+ */
+
+/*
+ * PonderReport
+ * ------------
+ * What a finished ponder did.
+ *  - ran        : false if nothing was pondering
+ *  - diff       : level the ponder worked for
+ *  - elapsed_ms : time it ran
+ *  - work       : nodes (alpha-beta levels) or playouts (BOT_MCTS) spent
+ *  - played_col : the opponent's actual reply (1..COLS), as passed to ponder_stop()
+ *  - hit_depth  : alpha-beta levels: depth the engine's answer to
+ *                 played_col was fully searched to (0 = not reached)
+ *  - hit_solved : BOT_PERFECT: the engine's answer to played_col was
+ *                 solved (or is in the opening book)
+ */
+typedef struct {
+    bool          ran;
+    BotDifficulty diff;
+    double        elapsed_ms;
+    uint64_t      work;
+    int           played_col;
+    int           hit_depth;
+    bool          hit_solved;
+} PonderReport;
+
+/*
+ * Start pondering b, where 'to_move' (the opponent) is about to play
+ * and 'engine' answers at level d. Stops any ponder still running.
+ * Does nothing for levels that do not search, on a full board, or
+ * without an engine pool.
+ */
+void ponder_start(const Board *b, Cell to_move, Cell engine, BotDifficulty d);
+
+/*
+ * Cancel the ponder and wait for its task, which returns within
+ * microseconds. played_col is the opponent's reply, or -1 if the
+ * position changed another way (undo, hint, quit). out may be NULL.
+ */
+void ponder_stop(int played_col, PonderReport *out);
+
+#endif /* PONDER_H */
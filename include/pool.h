@@ -0,0 +1,93 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/*
+ * Persistent work-stealing thread pool for engine work.
+ *
+ * Each worker owns a deque: tasks it submits go to the back and it
+ * takes its own work from the back (newest first), while idle workers
+ * steal from the front of the others (oldest first). Threads outside
+ * the pool submit to a shared injection deque that every worker steals
+ * from.
+ *
+ * Tasks are caller-owned and double as their own completion handle
+ * (future): submit one, then pool_wait() on it. A waiting thread runs
+ * its own queued subtasks instead of blocking while its task is
+ * pending, so a task may submit and wait on subtasks without tying up
+ * a worker. It never picks up unrelated work (a ponder, say), which
+ * could keep it from returning for as long as that work runs.
+ */
+
+#define POOL_MAX_WORKERS 64
+
+typedef void (*PoolFn)(void *arg);
+
+/*
+ * PoolTask
+ * --------
+ * One unit of work and its completion flag. Fill it with pool_submit()
+ * and keep it alive until pool_wait() returns.
+ */
+typedef struct PoolTask {
+    PoolFn           fn;
+    void            *arg;
+    atomic_bool      done;
+    const void      *owner;  // submitting task, or thread outside the pool
+    struct PoolTask *prev;   // deque links, owned by the pool
+    struct PoolTask *next;
+} PoolTask;
+
+typedef struct {
+    pthread_mutex_t lock;
+    PoolTask       *head;    // oldest: thieves take from here
+    PoolTask       *tail;    // newest: the owner takes from here
+} PoolDeque;
+
+typedef struct {
+    int             workers;
+    pthread_t       threads[POOL_MAX_WORKERS];
+    PoolDeque       deques[POOL_MAX_WORKERS + 1];  // [workers] = injection
+    pthread_mutex_t lock;     // guards sleeping on 'wake'
+    pthread_cond_t  wake;     // new task or finished task
+    atomic_int      queued;   // tasks sitting in any deque
+    atomic_bool     stop;
+} ThreadPool;
+
+/*
+ * Start 'workers' threads (clamped to 1..POOL_MAX_WORKERS).
+ * Returns 0 on success, -1 if no thread could be started.
+ */
+int pool_init(ThreadPool *pool, int workers);
+
+/* Stop and join the workers. Tasks still queued are not run. */
+void pool_destroy(ThreadPool *pool);
+
+/* Queue fn(arg) on 'task'. Safe from any thread, including workers. */
+void pool_submit(ThreadPool *pool, PoolTask *task, PoolFn fn, void *arg);
+
+/* True once the task has finished. */
+static inline bool pool_done(const PoolTask *task) {
+    return atomic_load_explicit(&((PoolTask*)task)->done, memory_order_acquire);
+}
+
+/*
+ * Wait until 'task' has finished, meanwhile running tasks that the
+ * caller (the task or outside thread calling pool_wait) submitted and
+ * that are still queued on its own deque.
+ */
+void pool_wait(ThreadPool *pool, PoolTask *task);
+
+/* Online CPUs, clamped to 1..POOL_MAX_WORKERS. */
+int pool_default_workers(void);
+
+/*
+ * Process-wide pool started on first use with CONNECT4_THREADS workers
+ * (default: one per online CPU). Returns NULL if it could not start.
+ */
+ThreadPool *pool_default(void);
+
+#endif /* POOL_H */
@@ -0,0 +1,222 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <limits.h>    // INT_MIN
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "board.h"
+#include "tt.h"
+
+/* Scores at or beyond +/-WIN_SCORE are forced wins/losses. */
+#define WIN_SCORE 1000000
+
+/* Upper bound on search threads (main thread plus Lazy SMP helpers). */
+#define SEARCH_MAX_THREADS 64
+
+/*
+ * SearchProgress
+ * --------------
+ * Best move so far of a running search, for another thread to poll.
+ * The search publishes after each completed iteration (MCTS: every few
+ * dozen playouts) and then bumps 'updates'; fields read between two
+ * publishes may mix adjacent updates.
+ *  - best_col : column 1..COLS, 0 before the first publish
+ *  - depth    : deepest completed iteration (MCTS: 0)
+ *  - score    : score of best_col from the mover's view
+ *               (MCTS: its win rate in per mille)
+ *  - work     : nodes (MCTS: playouts) so far
+ */
+typedef struct {
+    atomic_int       best_col;
+    atomic_int       depth;
+    atomic_int       score;
+    _Atomic uint64_t work;
+    atomic_uint      updates;
+} SearchProgress;
+
+/* Reset p before handing it to a search. */
+static inline void search_progress_init(SearchProgress *p) {
+    atomic_init(&p->best_col, 0);
+    atomic_init(&p->depth, 0);
+    atomic_init(&p->score, 0);
+    atomic_init(&p->work, 0);
+    atomic_init(&p->updates, 0);
+}
+
+static inline void search_progress_publish(SearchProgress *p, int best_col, int depth,
+                                           int score, uint64_t work) {
+    atomic_store_explicit(&p->best_col, best_col, memory_order_relaxed);
+    atomic_store_explicit(&p->depth, depth, memory_order_relaxed);
+    atomic_store_explicit(&p->score, score, memory_order_relaxed);
+    atomic_store_explicit(&p->work, work, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->updates, 1, memory_order_release);
+}
+
+/*
+ * SearchLimits
+ * ------------
+ * Budget for one move. Iterative deepening runs depth 1, 2, ... and
+ * stops when any limit is reached; the deepest completed iteration
+ * decides the move. Zero means "no limit" for each field.
+ *  - max_depth : deepest iteration to run (capped at the empty cells)
+ *  - time_ms   : wall-clock budget
+ *  - max_nodes : node budget
+ *  - threads   : search threads; 0 = one per worker of pool_default()
+ *  - cancel    : optional flag another thread sets to abandon the search
+ *  - progress  : optional, receives the result of every completed iteration
+ *  - no_quiesce: evaluate at the horizon even when a side can win at
+ *                once (benchmarks; by default forced wins, losses and
+ *                blocks are followed past the horizon until the position
+ *                is quiet)
+ *  - same_generation: do not start a new table generation
+ *                (tt_new_search()), so a caller such as the ponder can
+ *                keep several searches in one generation
+ *
+ * Depth 1 always completes, so a move is returned even when the
+ * budget is already exhausted. A cancelled search stops within a few
+ * microseconds, depth 1 or not.
+ */
+typedef struct {
+    int             max_depth;
+    int             time_ms;
+    uint64_t        max_nodes;
+    int             threads;
+    atomic_bool    *cancel;
+    SearchProgress *progress;
+    bool            no_quiesce;
+    bool            same_generation;
+} SearchLimits;
+
+/*
+ * SearchStats
+ * -----------
+ * What one search call did, summed over all iterations and threads.
+ *  - nodes         : positions visited
+ *  - quiesce_nodes : ... of them forced moves past the horizon
+ *  - evals         : leaves settled by evaluate_board()
+ *  - cutoffs       : beta cutoffs, and how many came from the first move
+ *    first_cutoffs   tried (a measure of move-ordering quality)
+ *  - tt_probes     : transposition table probes, and how many found
+ *    tt_hits         the position
+ *  - depth         : deepest completed iteration
+ *  - seldepth      : deepest ply below the root any thread reached,
+ *                    quiescence included
+ *  - elapsed_ms    : wall-clock time spent
+ *  - threads       : threads that searched; thread_nodes[i] is the
+ *    thread_nodes    nodes of thread i (0 = the calling thread)
+ *  - root_nodes    : calling thread only: nodes and milliseconds spent
+ *    root_ms         below each root column (index col-1)
+ */
+typedef struct {
+    uint64_t nodes;
+    uint64_t quiesce_nodes;
+    uint64_t evals;
+    uint64_t cutoffs;
+    uint64_t first_cutoffs;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    int      depth;
+    int      seldepth;
+    double   elapsed_ms;
+    int      threads;
+    uint64_t thread_nodes[SEARCH_MAX_THREADS];
+    uint64_t root_nodes[COLS];
+    double   root_ms[COLS];
+} SearchStats;
+
+/*
+ * SearchResult
+ * ------------
+ * Outcome of search_best_move().
+ *  - best_col : column 1..COLS, or -1 if no move is possible
+ *  - score    : score of best_col from the mover's view
+ *  - depth    : deepest completed iteration (also in stats)
+ *  - stats    : counters of the whole call
+ */
+typedef struct {
+    int         best_col;
+    int         score;
+    int         depth;
+    SearchStats stats;
+} SearchResult;
+
+/*
+ * search_best_move
+ * ----------------
+ * Iterative-deepening alpha-beta search for 'bot' to move on b.
+ * Each iteration searches the previous iteration's best column first.
+ *
+ * With more than one thread the search is Lazy SMP: helper tasks on the
+ * engine thread pool (pool.h) run their own iterative deepening on the
+ * same position (staggered depths, rotated root order) and share results
+ * only through the transposition table, so the work scales with cores
+ * rather than legal columns. The main thread's deepest completed
+ * iteration decides the move.
+ *
+ * out may be NULL. Returns the chosen column (1..COLS) or -1.
+ */
+int search_best_move(const Board *b, Cell bot, const SearchLimits *limits,
+                     SearchResult *out);
+
+/* Score of a column that cannot be played in a SearchRanking. */
+#define SEARCH_NO_SCORE INT_MIN
+
+/*
+ * SearchRanking
+ * -------------
+ * Outcome of search_rank_columns(): a score for every column.
+ *  - col_score  : score of each column (index col-1) from the mover's
+ *                 view, SEARCH_NO_SCORE for full columns; a forced
+ *                 result scores +/-(WIN_SCORE + ROWS*COLS - col_plies)
+ *  - col_plies  : plies to the forced win (score > WIN_SCORE/2) or loss
+ *                 (score < -WIN_SCORE/2) each column leads to, 0 if not forced
+ *  - best_col   : highest-scoring column 1..COLS, or -1 if the board is full
+ *  - depth      : deepest iteration completed for every column
+ *  - stats      : counters of the whole call
+ */
+typedef struct {
+    int         col_score[COLS];
+    int         col_plies[COLS];
+    int         best_col;
+    int         depth;
+    SearchStats stats;
+} SearchRanking;
+
+/*
+ * search_rank_columns
+ * -------------------
+ * Multi-PV search: iterative deepening like search_best_move(), but
+ * every legal root column is searched with a full window, so each one
+ * gets an exact score at the completed depth instead of a bound. A
+ * column whose result is forced keeps it and is not searched again.
+ * Runs on the calling thread only (limits->threads is ignored); the
+ * subtrees land in the shared table, so a later search_best_move() of
+ * the position or one of its children starts from them.
+ *
+ * out may be NULL. Returns the best column (1..COLS) or -1.
+ */
+int search_rank_columns(const Board *b, Cell bot, const SearchLimits *limits,
+                        SearchRanking *out);
+
+/* Workers of the engine thread pool, clamped to 1..SEARCH_MAX_THREADS. */
+int search_default_threads(void);
+
+/*
+ * Shared transposition table used by every search, allocated on first
+ * use with CONNECT4_TT_MB megabytes (default TT_DEFAULT_SIZE_MB).
+ * Returns NULL if it could not be allocated.
+ */
+TranspositionTable *search_tt(void);
+
+/* Forget cached search results (call when a new game starts). */
+void search_new_game(void);
+
+/*
+ * Copy the table's counters and size in KB.
+ * Returns false if no search has allocated the table yet.
+ */
+bool search_tt_stats(TTStats *out, size_t *out_kb);
+
+#endif /* SEARCH_H */
@@ -0,0 +1,91 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "board.h"
+
+#define SOLVER_TT_SIZE_MB 64
+
+/*
+ * Solver scores (side to move's view):
+ *   > 0 : win; the faster the win, the higher the score
+ *   = 0 : draw with best play
+ *   < 0 : loss; the later the loss, the closer to zero
+ * A win with the player's k-th piece scores (ROWS*COLS/2 + 1 - k).
+ */
+#define SOLVER_MIN_SCORE (-(ROWS * COLS) / 2 + 3)
+#define SOLVER_MAX_SCORE ((ROWS * COLS + 1) / 2 - 3)
+
+/*
+ * SolverLimits
+ * ------------
+ * Abort budget (0 = unlimited), plus an optional flag another thread
+ * sets to abort at once. An aborted solve reports solved = false and
+ * the caller should fall back to the heuristic search.
+ */
+typedef struct {
+    int          time_ms;
+    uint64_t     max_nodes;
+    atomic_bool *cancel;
+} SolverLimits;
+
+/*
+ * SolverResult
+ * ------------
+ *  - solved     : false if the budget ran out (other fields invalid)
+ *  - score      : exact game-theoretic score, see above
+ *  - plies      : plies until the game ends with best play
+ *                 (until the win/loss, or until the board is full)
+ *  - best_col   : column 1..COLS reaching that score
+ *  - col_score  : score of each column (1-based index - 1) for the
+ *                 side to move, SOLVER_INVALID for full columns
+ *  - nodes      : positions visited
+ *  - elapsed_ms : wall-clock time spent
+ */
+#define SOLVER_INVALID (-1000)
+
+typedef struct {
+    bool     solved;
+    int      score;
+    int      plies;
+    int      best_col;
+    int      col_score[COLS];
+    uint64_t nodes;
+    double   elapsed_ms;
+} SolverResult;
+
+/*
+ * solver_solve
+ * ------------
+ * Solve the position for 'to_move' exactly (negamax over bitboards with
+ * null-window probes, a transposition table and threat-based move
+ * ordering). Scores every playable column and picks the best one,
+ * preferring central columns on ties. The board must not already
+ * contain a four-in-a-row. limits may be NULL.
+ * Returns true if solved within the budget.
+ */
+bool solver_solve(const Board *b, Cell to_move, const SolverLimits *limits,
+                  SolverResult *out);
+
+/*
+ * Exact score of the position for 'to_move' alone (no per-column
+ * breakdown). Returns true if solved within the budget.
+ */
+bool solver_score(const Board *b, Cell to_move, const SolverLimits *limits,
+                  int *out_score, uint64_t *out_nodes);
+
+/* Plies until the end of the game for a score with 'moves' pieces played. */
+int solver_plies_to_end(int score, int moves);
+
+/*
+ * Start a new generation of the solver table (call when a new game
+ * starts): earlier results stay valid but are evicted first.
+ */
+void solver_new_game(void);
+
+/* Forget the solver's cached results. */
+void solver_reset(void);
+
+#endif /* SOLVER_H */
@@ -0,0 +1,81 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Event tracing, compiled in with -DCONNECT4_TRACE (make TRACE=1).
+ *
+ * Trace points record begin, end and instant events with a monotonic
+ * nanosecond timestamp into a ring buffer owned by the calling thread.
+ * Recording takes no lock and touches no shared cache line; only a
+ * thread's first event registers its ring. Each ring keeps the newest
+ * TRACE_RING_EVENTS events.
+ *
+ * trace_dump() writes all rings in the Chrome trace-event JSON format,
+ * which chrome://tracing and ui.perfetto.dev open. The game dumps at
+ * exit, and when 't' is typed at the move prompt, to
+ * CONNECT4_TRACE_FILE (default TRACE_DEFAULT_PATH).
+ *
+ * Without CONNECT4_TRACE the TRACE_* macros expand to nothing and no
+ * tracing code is built, so trace points cost nothing.
+ */
+
+/*
+ * A dump reads a ring while its thread may still be writing to it, so
+ * event fields are relaxed atomics and the dump re-checks the ring's
+ * head after copying: slots the thread reused meanwhile are dropped
+ * rather than written out torn.
+ */
+#define TRACE_RING_EVENTS  65536    // per thread, a power of two
+#define TRACE_DEFAULT_PATH "connect4-trace.json"
+
+#ifdef CONNECT4_TRACE
+
+/*
+ * Record one event for the calling thread: phase 'B' opens a slice,
+ * 'E' closes the innermost open one, 'i' marks an instant. name must
+ * stay valid until the dump (string literals do). arg is shown in the
+ * event's details.
+ */
+void trace_event(const char *name, char phase, int64_t arg);
+
+/* Name the calling thread in the trace (copied; at most 31 chars). */
+void trace_thread_name(const char *name);
+
+/* Pause or resume recording (on by default). */
+void trace_set_enabled(bool on);
+
+/* Events recorded so far by all threads, including overwritten ones. */
+uint64_t trace_event_count(void);
+
+/*
+ * Write every thread's ring to path as Chrome trace JSON. Threads may
+ * keep recording meanwhile; events they overwrite during the dump are
+ * left out. Returns 0 on success, -1 on I/O error.
+ */
+int trace_dump(const char *path);
+
+/* trace_dump() to CONNECT4_TRACE_FILE or TRACE_DEFAULT_PATH, and say so. */
+void trace_dump_default(void);
+
+#define TRACE_BEGIN(name)         trace_event((name), 'B', 0)
+#define TRACE_BEGIN_ARG(name, v)  trace_event((name), 'B', (int64_t)(v))
+#define TRACE_END(name)           trace_event((name), 'E', 0)
+#define TRACE_INSTANT(name, v)    trace_event((name), 'i', (int64_t)(v))
+#define TRACE_THREAD_NAME(name)   trace_thread_name(name)
+#define TRACE_DUMP_DEFAULT()      trace_dump_default()
+
+#else
+
+#define TRACE_BEGIN(name)         ((void)0)
+#define TRACE_BEGIN_ARG(name, v)  ((void)0)
+#define TRACE_END(name)           ((void)0)
+#define TRACE_INSTANT(name, v)    ((void)0)
+#define TRACE_THREAD_NAME(name)   ((void)0)
+#define TRACE_DUMP_DEFAULT()      ((void)0)
+
+#endif /* CONNECT4_TRACE */
+
+#endif /* TRACE_H */
@@ -0,0 +1,122 @@
+#ifndef TT_H
+#define TT_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Transposition table for the bot search.
+ *
+ * Entries are grouped in 64-byte buckets (one cache line) of
+ * TT_BUCKET_ENTRIES slots. Each slot is two 64-bit words written
+ * without locks: the packed data and (key ^ data). A probe only
+ * accepts a slot whose two words agree, so a torn read from a
+ * concurrent store looks like a miss instead of a wrong result.
+ */
+
+#define TT_BUCKET_ENTRIES   4
+#define TT_DEFAULT_SIZE_MB  16
+#define TT_REPLACE_MARGIN   2   // plies a same-key store may be shallower
+
+/*
+ * TTBound
+ * -------
+ * How a stored score relates to the true value of the position.
+ */
+typedef enum {
+    TT_BOUND_NONE  = 0,
+    TT_BOUND_EXACT = 1,  // score is exact
+    TT_BOUND_LOWER = 2,  // true value >= score (search failed high)
+    TT_BOUND_UPPER = 3   // true value <= score (search failed low)
+} TTBound;
+
+/*
+ * TTEntry
+ * -------
+ * Unpacked view of one slot, as returned by tt_probe().
+ */
+typedef struct {
+    int     score;
+    int     depth;
+    TTBound bound;
+    int     move;   // best column 1..COLS, or 0 if unknown
+} TTEntry;
+
+/*
+ * TTStats
+ * -------
+ * Probe/store counters. Searches count into a private TTStats and
+ * fold it into the table with tt_stats_add() when they finish, so
+ * the hot path never touches shared counters.
+ *  - hits       : probe found the position
+ *  - misses     : probe did not find the position
+ *  - collisions : store evicted a different position written during
+ *                 the current search generation
+ */
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t collisions;
+} TTStats;
+
+typedef struct {
+    _Atomic uint64_t check;  // key ^ data
+    _Atomic uint64_t data;
+} TTSlot;
+
+typedef struct {
+    _Alignas(64) TTSlot slots[TT_BUCKET_ENTRIES];
+} TTBucket;
+
+typedef struct {
+    TTBucket        *buckets;
+    size_t           bucket_count;  // power of two
+    _Atomic uint8_t  generation;   // bumped by tt_new_search(), read by stores
+    _Atomic uint64_t hits;
+    _Atomic uint64_t misses;
+    _Atomic uint64_t collisions;
+} TranspositionTable;
+
+/*
+ * Allocate a table of (at most) size_mb megabytes, rounded down to a
+ * power-of-two number of buckets. Returns 0 on success, -1 on failure.
+ */
+int tt_init(TranspositionTable *tt, size_t size_mb);
+
+/* Release the table memory. */
+void tt_free(TranspositionTable *tt);
+
+/* Forget all stored positions and reset the counters. */
+void tt_clear(TranspositionTable *tt);
+
+/*
+ * Start a new search generation. Entries from older generations are
+ * replaced first; call once per bot move (or game), not per thread or
+ * per sub-search. Safe while other threads store.
+ */
+void tt_new_search(TranspositionTable *tt);
+
+/* Look up key. Returns true and fills *out on a hit. */
+bool tt_probe(const TranspositionTable *tt, uint64_t key, TTEntry *out,
+              TTStats *stats);
+
+/*
+ * Store a search result for key (replacing the least useful slot).
+ * An entry of the current generation already holding key is only
+ * replaced by a result at most TT_REPLACE_MARGIN plies shallower; an
+ * exact entry only by another exact result or a deeper bound. Entries
+ * from earlier generations are always replaced. A move of 0 keeps the
+ * stored move.
+ */
+void tt_store(TranspositionTable *tt, uint64_t key, int depth, int score,
+              TTBound bound, int move, TTStats *stats);
+
+/* Fold a search's private counters into the table totals. */
+void tt_stats_add(TranspositionTable *tt, const TTStats *stats);
+
+/* Read the accumulated counters. */
+void tt_stats_get(const TranspositionTable *tt, TTStats *out);
+
+#endif /* TT_H */
@@ -0,0 +1,271 @@
+#include "batch.h"
+#include "eval.h"
+#include <pthread.h>
+#include <stdlib.h>    // aligned_alloc, free
+#include <string.h>    // memset
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_HAVE_AVX2 1
+#endif
+
+/* Bits set at column c * BOARD_H1 gathered to bit 42 + c by one multiply:
+   the partial products of different columns never share a bit. */
+#define BATCH_GATHER_MAGIC 0x0000041041041040ULL
+
+/* One bit per column (bit c = column c) with any bit of x in it. */
+static inline uint8_t batch_columns(Bitboard x) {
+    Bitboard y = x | (x >> 1) | (x >> 2) | (x >> 3) | (x >> 4) | (x >> 5);
+    return (uint8_t)((((y & BOARD_BOTTOM_MASK) * BATCH_GATHER_MAGIC) >> 42) & 0x7F);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Allocation                                                                */
+/* ------------------------------------------------------------------------- */
+
+static void *batch_alloc(size_t bytes) {
+    size_t rounded = (bytes + 31) & ~(size_t)31;
+    return aligned_alloc(32, rounded ? rounded : 32);
+}
+
+int batch_init(PositionBatch *pb, size_t capacity) {
+    memset(pb, 0, sizeof(*pb));
+    pb->capacity = capacity;
+    pb->a      = batch_alloc(capacity * sizeof(Bitboard));
+    pb->b      = batch_alloc(capacity * sizeof(Bitboard));
+    pb->eval_a = batch_alloc(capacity * sizeof(int32_t));
+    pb->eval_b = batch_alloc(capacity * sizeof(int32_t));
+    pb->legal  = batch_alloc(capacity);
+    pb->win_a  = batch_alloc(capacity);
+    pb->win_b  = batch_alloc(capacity);
+
+    if (!pb->a || !pb->b || !pb->eval_a || !pb->eval_b ||
+        !pb->legal || !pb->win_a || !pb->win_b) {
+        batch_free(pb);
+        return -1;
+    }
+    return 0;
+}
+
+void batch_free(PositionBatch *pb) {
+    free(pb->a);
+    free(pb->b);
+    free(pb->eval_a);
+    free(pb->eval_b);
+    free(pb->legal);
+    free(pb->win_a);
+    free(pb->win_b);
+    memset(pb, 0, sizeof(*pb));
+}
+
+bool batch_push(PositionBatch *pb, const Board *b) {
+    if (pb->count >= pb->capacity) {
+        return false;
+    }
+    pb->a[pb->count] = b->stones[0];
+    pb->b[pb->count] = b->stones[1];
+    pb->count++;
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Scalar kernel                                                             */
+/* ------------------------------------------------------------------------- */
+
+static void batch_run_scalar(PositionBatch *pb, size_t from) {
+    EvalCountFn count = eval_count_kernel("scalar");
+    Bitboard    center = board_column_mask(COLS / 2);
+
+    for (size_t i = from; i < pb->count; i++) {
+        Bitboard a    = pb->a[i];
+        Bitboard b    = pb->b[i];
+        Bitboard mask = a | b;
+        Bitboard play = board_playable(mask);
+        EvalCounts counts;
+
+        count(a, b, &counts);
+        pb->eval_a[i] = eval_score_counts(&counts, a & center, b & center, 0);
+        pb->eval_b[i] = eval_score_counts(&counts, b & center, a & center, 1);
+        pb->legal[i]  = batch_columns(play);
+        pb->win_a[i]  = batch_columns(board_winning_cells(a, mask) & play);
+        pb->win_b[i]  = batch_columns(board_winning_cells(b, mask) & play);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* AVX2 kernel: four positions per vector                                    */
+/* ------------------------------------------------------------------------- */
+
+#ifdef BATCH_HAVE_AVX2
+#define BATCH_TARGET __attribute__((target("avx2")))
+
+/* Popcount of each 64-bit lane (nibble lookup, then byte sums). */
+BATCH_TARGET static inline __m256i batch_popcount(__m256i x) {
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i lo  = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low));
+    __m256i hi  = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi64(x, 4), low));
+    return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+BATCH_TARGET static inline __m256i batch_shr(__m256i x, int n) {
+    return _mm256_srl_epi64(x, _mm_cvtsi32_si128(n));
+}
+
+BATCH_TARGET static inline __m256i batch_shl(__m256i x, int n) {
+    return _mm256_sll_epi64(x, _mm_cvtsi32_si128(n));
+}
+
+/*
+ * Window score of x against o (both four positions) summed over the
+ * four directions: the bit-sliced counts of eval.c, lane-wise.
+ */
+BATCH_TARGET static __m256i batch_windows(__m256i x, __m256i o, const int own[5], const int opp[5],
+                                          __m256i *score_o) {
+    static const int DIR[4] = { BOARD_H1, 1, BOARD_H1 + 1, BOARD_H1 - 1 };
+    const __m256i full = _mm256_set1_epi64x((long long)BOARD_FULL_MASK);
+    __m256i sx = _mm256_setzero_si256();
+    __m256i so = _mm256_setzero_si256();
+
+    for (int i = 0; i < 4; i++) {
+        int d = DIR[i];
+        __m256i starts = _mm256_and_si256(_mm256_and_si256(full, batch_shr(full, d)),
+                                          _mm256_and_si256(batch_shr(full, 2 * d), batch_shr(full, 3 * d)));
+        __m256i v[2] = { x, o };
+
+        for (int p = 0; p < 2; p++) {
+            __m256i s  = v[p];
+            __m256i t  = v[p ^ 1];
+            __m256i any = _mm256_or_si256(_mm256_or_si256(t, batch_shr(t, d)),
+                                          _mm256_or_si256(batch_shr(t, 2 * d), batch_shr(t, 3 * d)));
+            __m256i open = _mm256_andnot_si256(any, starts);
+
+            __m256i x1 = batch_shr(s, d), x2 = batch_shr(s, 2 * d), x3 = batch_shr(s, 3 * d);
+            __m256i s1 = _mm256_xor_si256(s, x1),  c1 = _mm256_and_si256(s, x1);
+            __m256i s2 = _mm256_xor_si256(x2, x3), c2 = _mm256_and_si256(x2, x3);
+            __m256i lo = _mm256_xor_si256(s1, s2), cy = _mm256_and_si256(s1, s2);
+            __m256i mid  = _mm256_xor_si256(_mm256_xor_si256(c1, c2), cy);
+            __m256i high = _mm256_or_si256(_mm256_and_si256(c1, c2),
+                                           _mm256_and_si256(_mm256_or_si256(c1, c2), cy));
+
+            __m256i n[4];
+            n[0] = batch_popcount(_mm256_and_si256(open, _mm256_andnot_si256(_mm256_or_si256(mid, high), lo)));
+            n[1] = batch_popcount(_mm256_and_si256(open, _mm256_andnot_si256(lo, mid)));
+            n[2] = batch_popcount(_mm256_and_si256(open, _mm256_and_si256(lo, mid)));
+            n[3] = batch_popcount(_mm256_and_si256(open, high));
+
+            /* counts fit the low 32 bits of each lane; so do the sums */
+            for (int k = 0; k < 4; k++) {
+                __m256i w_for_x = _mm256_set1_epi32(p == 0 ? own[k + 1] : opp[k + 1]);
+                __m256i w_for_o = _mm256_set1_epi32(p == 0 ? opp[k + 1] : own[k + 1]);
+                sx = _mm256_add_epi32(sx, _mm256_mullo_epi32(n[k], w_for_x));
+                so = _mm256_add_epi32(so, _mm256_mullo_epi32(n[k], w_for_o));
+            }
+        }
+    }
+
+    *score_o = so;
+    return sx;
+}
+
+/* Cells where x would complete a four, as board_winning_cells(). */
+BATCH_TARGET static __m256i batch_winning_cells(__m256i x, __m256i mask) {
+    static const int D[3] = { BOARD_H1, BOARD_H1 - 1, BOARD_H1 + 1 };
+    const __m256i full = _mm256_set1_epi64x((long long)BOARD_FULL_MASK);
+
+    __m256i r = _mm256_and_si256(_mm256_and_si256(batch_shl(x, 1), batch_shl(x, 2)), batch_shl(x, 3));
+
+    for (int k = 0; k < 3; k++) {
+        int d = D[k];
+        __m256i p = _mm256_and_si256(batch_shl(x, d), batch_shl(x, 2 * d));
+        r = _mm256_or_si256(r, _mm256_and_si256(p, batch_shl(x, 3 * d)));
+        r = _mm256_or_si256(r, _mm256_and_si256(p, batch_shr(x, d)));
+
+        p = _mm256_and_si256(batch_shr(x, d), batch_shr(x, 2 * d));
+        r = _mm256_or_si256(r, _mm256_and_si256(p, batch_shl(x, d)));
+        r = _mm256_or_si256(r, _mm256_and_si256(p, batch_shr(x, 3 * d)));
+    }
+
+    return _mm256_andnot_si256(mask, _mm256_and_si256(r, full));
+}
+
+/* Runs whole groups of four; returns the index of the first position left. */
+BATCH_TARGET static size_t batch_run_avx2(PositionBatch *pb) {
+    int own[5], opp[5];
+    eval_window_weights(own, opp);
+
+    const __m256i center = _mm256_set1_epi64x((long long)board_column_mask(COLS / 2));
+    const __m256i bottom = _mm256_set1_epi64x((long long)BOARD_BOTTOM_MASK);
+    const __m256i full   = _mm256_set1_epi64x((long long)BOARD_FULL_MASK);
+    const __m256i cw     = _mm256_set1_epi32(EVAL_CENTER);
+
+    size_t i = 0;
+    for (; i + 4 <= pb->count; i += 4) {
+        __m256i a    = _mm256_loadu_si256((const __m256i*)(pb->a + i));
+        __m256i b    = _mm256_loadu_si256((const __m256i*)(pb->b + i));
+        __m256i mask = _mm256_or_si256(a, b);
+
+        __m256i sb;
+        __m256i sa = batch_windows(a, b, own, opp, &sb);
+
+        __m256i ca = batch_popcount(_mm256_and_si256(a, center));
+        __m256i cb = batch_popcount(_mm256_and_si256(b, center));
+        __m256i cd = _mm256_mullo_epi32(_mm256_sub_epi32(ca, cb), cw);
+        sa = _mm256_add_epi32(sa, cd);
+        sb = _mm256_sub_epi32(sb, cd);
+
+        __m256i play = _mm256_and_si256(_mm256_add_epi64(mask, bottom), full);
+        __m256i wa   = _mm256_and_si256(batch_winning_cells(a, mask), play);
+        __m256i wb   = _mm256_and_si256(batch_winning_cells(b, mask), play);
+
+        int64_t  va[4], vb[4];
+        uint64_t pl[4], xa[4], xb[4];
+        _mm256_storeu_si256((__m256i*)va, sa);
+        _mm256_storeu_si256((__m256i*)vb, sb);
+        _mm256_storeu_si256((__m256i*)pl, play);
+        _mm256_storeu_si256((__m256i*)xa, wa);
+        _mm256_storeu_si256((__m256i*)xb, wb);
+
+        for (int j = 0; j < 4; j++) {
+            pb->eval_a[i + j] = (int32_t)va[j];
+            pb->eval_b[i + j] = (int32_t)vb[j];
+            pb->legal[i + j]  = batch_columns(pl[j]);
+            pb->win_a[i + j]  = batch_columns(xa[j]);
+            pb->win_b[i + j]  = batch_columns(xb[j]);
+        }
+    }
+    return i;
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* Dispatch                                                                  */
+/* ------------------------------------------------------------------------- */
+
+static int            g_batch_avx2 = 0;
+static pthread_once_t g_batch_once = PTHREAD_ONCE_INIT;
+
+static void batch_select_kernel(void) {
+#ifdef BATCH_HAVE_AVX2
+    __builtin_cpu_init();
+    g_batch_avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+const char *batch_kernel_name(void) {
+    pthread_once(&g_batch_once, batch_select_kernel);
+    return g_batch_avx2 ? "avx2" : "scalar";
+}
+
+void batch_run(PositionBatch *pb) {
+    pthread_once(&g_batch_once, batch_select_kernel);
+
+    size_t done = 0;
+#ifdef BATCH_HAVE_AVX2
+    if (g_batch_avx2) {
+        done = batch_run_avx2(pb);
+    }
+#endif
+    batch_run_scalar(pb, done);
+}
@@ -1,4 +1,5 @@
 #include "board.h"
+#include "trace.h"
 #include <stdio.h>
 
 /* ANSI color codes for colored pieces in the terminal. */
@@ -9,18 +10,12 @@
 /*
  * board_init
  * ----------
- * Set all cells to empty and reset column heights to zero.
+ * Clear both players' bitboards (no pieces, all heights = 0).
  */
 void board_init(Board *b) {
-    for (int r = 0; r < ROWS; ++r) {
-        for (int c = 0; c < COLS; ++c) {
-            b->grid[r][c] = CELL_EMPTY;
-        }
-    }
-
-    for (int c = 0; c < COLS; ++c) {
-        b->heights[c] = 0;
-    }
+    b->stones[0] = 0;
+    b->stones[1] = 0;
+    b->moves     = 0;
 }
 
 /*
@@ -39,46 +34,58 @@ bool board_drop(Board *b, int col1_based, Cell piece, int *out_row) {
     if (c < 0 || c >= COLS) {
         return false;
     }
-    if (b->heights[c] >= ROWS) {
+    if (piece != CELL_A && piece != CELL_B) {
         return false;
     }
 
-    int r = ROWS - 1 - b->heights[c];
+    Bitboard col_mask = board_column_mask(c);
+    Bitboard mask     = board_mask(b);
+    if ((mask & col_mask) == col_mask) {
+        return false;
+    }
 
-    b->grid[r][c] = piece;
-    b->heights[c]++;
+    /* Adding the column's bottom bit to its filled cells carries into
+       the lowest empty cell. */
+    Bitboard move = (mask + (BOARD_BOTTOM_MASK & col_mask)) & col_mask;
+    int h    = __builtin_popcountll(mask & col_mask);
+    int p    = board_player_index(piece);
+    b->stones[p] |= move;
+    b->history[b->moves++] = (int8_t)c;
 
     if (out_row) {
-        *out_row = r;
+        *out_row = ROWS - h - 1;
     }
 
     return true;
 }
 
 /*
- * ray_count
- * ---------
- * Count matching pieces of type p starting from (r, c) and moving
- * in direction (dr, dc), stopping at the first mismatch or edge.
- * Does not count the starting cell.
+ * board_undo
+ * ----------
+ * Pop the last move from the move stack and clear its cell
+ * (the highest occupied cell of that column).
+ *
+ * Returns:
+ *   true  if a piece was removed.
+ *   false if the board is empty.
  */
-static int ray_count(const Board *b, int r, int c, int dr, int dc, Cell p) {
-    int cnt = 0;
+bool board_undo(Board *b, int *out_col1_based) {
+    if (b->moves <= 0) {
+        return false;
+    }
 
-    for (int i = 1; i < 4; i++) {
-        int rr = r + dr * i;
-        int cc = c + dc * i;
+    int c = b->history[--b->moves];
+    int h = board_height(b, c) - 1;
 
-        if (rr < 0 || rr >= ROWS || cc < 0 || cc >= COLS) {
-            break;
-        }
-        if (b->grid[rr][cc] != p) {
-            break;
-        }
-        cnt++;
+    Bitboard bit = ((Bitboard)1) << (c * BOARD_H1 + h);
+    b->stones[0] &= ~bit;
+    b->stones[1] &= ~bit;
+
+    if (out_col1_based) {
+        *out_col1_based = c + 1;
     }
 
-    return cnt;
+    return true;
 }
 
 /*
@@ -86,24 +93,34 @@ static int ray_count(const Board *b, int r, int c, int dr, int dc, Cell p) {
  * ----------------
  * Check if the piece p at position (r, c) completes a 4-in-a-row
  * horizontally, vertically, or diagonally.
+ *
+ * For each direction, m & (m >> 2d) with m = x & (x >> d) marks the
+ * lowest cell of every aligned four; the move wins if one of those
+ * fours covers (r, c).
  */
 bool board_is_winning(const Board *b, int r, int c, Cell p) {
-    const int D[4][2] = {
-        { 0,  1},  /* horizontal */
-        { 1,  0},  /* vertical   */
-        { 1,  1},  /* diag down-right  */
-        { 1, -1}   /* diag down-left   */
+    static const int D[4] = {
+        BOARD_H1,      /* horizontal      */
+        1,             /* vertical        */
+        BOARD_H1 + 1,  /* diag up-right   */
+        BOARD_H1 - 1   /* diag down-right */
     };
 
+    if (r < 0 || r >= ROWS || c < 0 || c >= COLS) {
+        return false;
+    }
+
+    Bitboard cell = board_cell_bit(r, c);
+    Bitboard x    = b->stones[board_player_index(p)] | cell;
+
     for (int k = 0; k < 4; k++) {
-        int dr = D[k][0];
-        int dc = D[k][1];
+        int d = D[k];
 
-        int total = 1
-                    + ray_count(b, r, c,  dr,  dc, p)
-                    + ray_count(b, r, c, -dr, -dc, p);
+        Bitboard m      = x & (x >> d);
+        Bitboard starts = m & (m >> (2 * d));
+        Bitboard cover  = cell | (cell >> d) | (cell >> (2 * d)) | (cell >> (3 * d));
 
-        if (total >= 4) {
+        if (starts & cover) {
             return true;
         }
     }
@@ -111,18 +128,91 @@ bool board_is_winning(const Board *b, int r, int c, Cell p) {
     return false;
 }
 
+/*
+ * board_winning_cells
+ * -------------------
+ * For every direction d, a cell completes a four if the three cells on
+ * one side are ours (x<<d & x<<2d & x<<3d), or two on one side and one
+ * on the other, for each of the two orientations.
+ */
+Bitboard board_winning_cells(Bitboard stones, Bitboard mask) {
+    static const int D[3] = { BOARD_H1, BOARD_H1 - 1, BOARD_H1 + 1 };
+    Bitboard x = stones;
+
+    /* vertical: only three below can complete a four */
+    Bitboard r = (x << 1) & (x << 2) & (x << 3);
+
+    for (int k = 0; k < 3; k++) {
+        int d = D[k];
+        Bitboard p;
+
+        p  = (x << d) & (x << (2 * d));
+        r |= p & (x << (3 * d));
+        r |= p & (x >> d);
+
+        p  = (x >> d) & (x >> (2 * d));
+        r |= p & (x << d);
+        r |= p & (x >> (3 * d));
+    }
+
+    return r & (BOARD_FULL_MASK ^ mask);
+}
+
+/*
+ * board_mirror
+ * ------------
+ * Move each column's BOARD_H1 bits to the mirrored column.
+ */
+Bitboard board_mirror(Bitboard x) {
+    Bitboard col_bits = (((Bitboard)1) << BOARD_H1) - 1;
+    Bitboard m = 0;
+
+    for (int c = 0; c < COLS; c++) {
+        Bitboard bits = (x >> (c * BOARD_H1)) & col_bits;
+        m |= bits << ((COLS - 1 - c) * BOARD_H1);
+    }
+
+    return m;
+}
+
 /*
  * board_is_full
  * -------------
  * Return true if no more pieces can be dropped (all columns are full).
  */
 bool board_is_full(const Board *b) {
-    for (int c = 0; c < COLS; c++) {
-        if (b->heights[c] < ROWS) {
-            return false;
+    return board_mask(b) == BOARD_FULL_MASK;
+}
+
+/*
+ * board_play_sequence
+ * -------------------
+ * Replay a string of 1-based column digits. The side to move follows
+ * from the piece count, so A moves first on an empty board.
+ */
+int board_play_sequence(Board *b, const char *seq) {
+    int  n    = 0;
+    Cell turn = (__builtin_popcountll(board_mask(b)) % 2 == 0) ? CELL_A : CELL_B;
+
+    for (const char *s = seq; *s; s++) {
+        int col = *s - '0';
+        int r;
+
+        if (col < 1 || col > COLS) {
+            return -1;
         }
+        if (!board_drop(b, col, turn, &r)) {
+            return -1;
+        }
+        n++;
+
+        if (board_is_winning(b, r, col - 1, turn) && s[1] != '\0') {
+            return -1;
+        }
+        turn = (turn == CELL_A) ? CELL_B : CELL_A;
     }
-    return true;
+
+    return n;
 }
 
 /*
@@ -131,6 +221,8 @@ bool board_is_full(const Board *b) {
  * Print the board to stdout, with color for each player piece.
  */
 void board_print(const Board *b) {
+    TRACE_BEGIN("render");
+
     /* Top border */
     printf("   +");
     for (int c = 0; c < COLS; c++) {
@@ -142,7 +234,7 @@ void board_print(const Board *b) {
     for (int r = 0; r < ROWS; r++) {
         printf("   |");
         for (int c = 0; c < COLS; c++) {
-            Cell cell = b->grid[r][c];
+            Cell cell = board_cell(b, r, c);
             char ch = (char)cell;
 
             const char *start = "";
@@ -178,5 +270,43 @@ void board_print(const Board *b) {
         printf(" %d  ", c);
     }
     printf("\n");
+
+    TRACE_END("render");
+}
+
+/*
+ * board_compute_keys
+ * ------------------
+ * XOR the Zobrist code of every piece into the key, and of the piece
+ * at the mirrored column into the mirror key.
+ */
+void board_compute_keys(const Board *b, uint64_t *out_key, uint64_t *out_mirror_key) {
+    uint64_t key    = 0;
+    uint64_t mirror = 0;
+
+    for (int p = 0; p < 2; p++) {
+        for (int c = 0; c < COLS; c++) {
+            for (int h = 0; h < ROWS; h++) {
+                if (b->stones[p] & (((Bitboard)1) << (c * BOARD_H1 + h))) {
+                    key    ^= board_zobrist(p, c * BOARD_H1 + h);
+                    mirror ^= board_zobrist(p, (COLS - 1 - c) * BOARD_H1 + h);
+                }
+            }
+        }
+    }
+
+    if (out_key)        *out_key        = key;
+    if (out_mirror_key) *out_mirror_key = mirror;
 }
 
+/*
+ * board_canonical_key
+ * -------------------
+ * The smaller of the two keys, so a position and its mirror image
+ * share one.
+ */
+uint64_t board_canonical_key(const Board *b) {
+    uint64_t key, mirror;
+    board_compute_keys(b, &key, &mirror);
+    return (mirror < key) ? mirror : key;
+}
@@ -0,0 +1,211 @@
+#define _XOPEN_SOURCE 700
+
+#include "book.h"
+#include "solver.h"    // SOLVER_INVALID
+#include <fcntl.h>     // open
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>    // getenv, qsort
+#include <string.h>    // memcmp, memcpy, memset
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close
+
+static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
+
+uint64_t book_key(const Board *b, Cell to_move) {
+    Bitboard cur  = b->stones[board_player_index(to_move)];
+    Bitboard mask = board_mask(b);
+
+    uint64_t key    = cur + mask + BOARD_BOTTOM_MASK;
+    uint64_t mirror = board_mirror(cur) + board_mirror(mask) + BOARD_BOTTOM_MASK;
+
+    return (mirror < key) ? mirror : key;
+}
+
+int book_open(OpeningBook *bk, const char *path) {
+    memset(bk, 0, sizeof(*bk));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t len = (size_t)st.st_size;
+    void  *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    /* Compare count against the file size without multiplying it, so a
+       crafted count cannot wrap around and pass. */
+    const BookHeader *h = (const BookHeader*)map;
+    size_t body = len - sizeof(BookHeader);
+    if (memcmp(h->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0 ||
+        body % sizeof(uint64_t) != 0 || h->count != body / sizeof(uint64_t)) {
+        munmap(map, len);
+        return -1;
+    }
+
+    bk->entries = (const uint64_t*)(h + 1);
+    bk->count   = (size_t)h->count;
+    bk->max_ply = (int)h->max_ply;
+    bk->map     = map;
+    bk->map_len = len;
+    return 0;
+}
+
+void book_close(OpeningBook *bk) {
+    if (bk->map) {
+        munmap(bk->map, bk->map_len);
+    }
+    memset(bk, 0, sizeof(*bk));
+}
+
+/* Binary search for key; entries compare by their high 56 bits. */
+static bool book_find(const OpeningBook *bk, uint64_t key, int *out_score) {
+    size_t lo = 0;
+    size_t hi = bk->count;
+
+    while (lo < hi) {
+        size_t   mid = lo + (hi - lo) / 2;
+        uint64_t k   = bk->entries[mid] >> 8;
+        if (k < key) {
+            lo = mid + 1;
+        } else if (k > key) {
+            hi = mid;
+        } else {
+            *out_score = (int)(int8_t)(uint8_t)bk->entries[mid];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool book_probe(const OpeningBook *bk, const Board *b, Cell to_move, int *out_score) {
+    if (!bk || bk->count == 0) {
+        return false;
+    }
+    if (__builtin_popcountll(board_mask(b)) > bk->max_ply) {
+        return false;
+    }
+    return book_find(bk, book_key(b, to_move), out_score);
+}
+
+bool book_column_scores(const OpeningBook *bk, const Board *b, Cell to_move,
+                        int col_score[COLS]) {
+    if (!bk || __builtin_popcountll(board_mask(b)) >= bk->max_ply) {
+        return false;
+    }
+
+    Cell  opp   = (to_move == CELL_A) ? CELL_B : CELL_A;
+    Board child = *b;
+    int   moves = __builtin_popcountll(board_mask(b));
+    bool  any   = false;
+
+    for (int col = 1; col <= COLS; col++) {
+        int r;
+        col_score[col - 1] = SOLVER_INVALID;
+        if (!board_drop(&child, col, to_move, &r)) continue;
+
+        int score;
+        bool found = true;
+        if (board_is_winning(&child, r, col - 1, to_move)) {
+            score = (ROWS * COLS + 1 - moves) / 2;
+        } else if (book_probe(bk, &child, opp, &score)) {
+            score = -score;
+        } else {
+            found = false;
+        }
+        board_undo(&child, NULL);
+
+        if (!found) {
+            return false;
+        }
+        col_score[col - 1] = score;
+        any = true;
+    }
+
+    return any;
+}
+
+bool book_best_move(const OpeningBook *bk, const Board *b, Cell to_move,
+                    int *out_col, int *out_score) {
+    int col_score[COLS];
+    if (!book_column_scores(bk, b, to_move, col_score)) {
+        return false;
+    }
+
+    int best_col = -1;
+    for (int i = 0; i < COLS; i++) {
+        int col = ORDER[i];
+        if (col_score[col - 1] == SOLVER_INVALID) continue;
+        if (best_col == -1 || col_score[col - 1] > col_score[best_col - 1]) {
+            best_col = col;
+        }
+    }
+
+    *out_col = best_col;
+    if (out_score) {
+        *out_score = col_score[best_col - 1];
+    }
+    return true;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+int book_write(const char *path, int max_ply, uint64_t *entries, size_t count) {
+    qsort(entries, count, sizeof(*entries), cmp_u64);
+
+    BookHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    h.max_ply = (uint32_t)max_ply;
+    h.count   = count;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+             fwrite(entries, sizeof(*entries), count, f) == count;
+
+    if (fclose(f) != 0) {
+        ok = 0;
+    }
+    return ok ? 0 : -1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Process-wide book                                                         */
+/* ------------------------------------------------------------------------- */
+
+static OpeningBook    g_book;
+static int            g_book_ready = 0;
+static pthread_once_t g_book_once  = PTHREAD_ONCE_INIT;
+
+static void book_default_init(void) {
+    const char *path = getenv("CONNECT4_BOOK");
+    if (!path || !*path) {
+        path = BOOK_DEFAULT_PATH;
+    }
+    g_book_ready = (book_open(&g_book, path) == 0);
+}
+
+const OpeningBook *book_default(void) {
+    pthread_once(&g_book_once, book_default_init);
+    return g_book_ready ? &g_book : NULL;
+}
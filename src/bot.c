@@ -0,0 +1,643 @@
+#include "bot.h"
+#include "book.h"
+#include "trace.h"
+#include <limits.h>    // INT_MIN
+#include <pthread.h>
+#include <stdlib.h>    // rand, srand
+#include <string.h>    // memset
+#include <time.h>      // time
+
+/* ------------------------------------------------------------------------- */
+/* Difficulty budgets                                                        */
+/* ------------------------------------------------------------------------- */
+
+/* Hard bot (and hints): iterative deepening for up to half a second. */
+static const SearchLimits HARD_LIMITS = { .max_depth = 0, .time_ms = 500, .max_nodes = 0 };
+
+/* Perfect bot: exact solve for up to two seconds. Early-game positions
+   take longer than that and fall back to the hard search. */
+static const SolverLimits PERFECT_LIMITS = { .time_ms = 2000, .max_nodes = 0 };
+
+/* Monte Carlo bot: playouts for half a second, like the hard search. */
+static const MctsLimits MCTS_LIMITS = { .playouts = 0, .time_ms = 500, .threads = 0 };
+
+const SolverLimits *bot_solver_limits(void) {
+    return &PERFECT_LIMITS;
+}
+
+const MctsLimits *bot_mcts_limits(void) {
+    return &MCTS_LIMITS;
+}
+
+const SearchLimits *bot_search_limits(BotDifficulty d) {
+    switch (d) {
+        case BOT_HARD:
+        case BOT_PERFECT:
+            return &HARD_LIMITS;
+        default:
+            return NULL;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Shared helpers                                                            */
+/* ------------------------------------------------------------------------- */
+
+/* Initialize the random number generator once per program run. */
+static void rng_init_once(void) {
+    static int init = 0;
+    if (!init) {
+        srand((unsigned)time(NULL));
+        init = 1;
+    }
+}
+
+
+/* Test if dropping p in column col would win (the board is not modified). */
+int would_win_if_drop(const Board *b, int col, Cell p) {
+    if (col < 1 || col > COLS) {
+        return 0;
+    }
+    Bitboard mask = board_mask(b);
+    Bitboard wins = board_winning_cells(b->stones[board_player_index(p)], mask);
+    return (wins & board_playable(mask) & board_column_mask(col - 1)) != 0;
+}
+
+/* List the 1-based columns holding a bit of 'cells', left to right. */
+static int cells_to_columns(Bitboard cells, int out[COLS]) {
+    int n = 0;
+    for (; cells; cells &= cells - 1) {
+        out[n++] = board_bit_column(cells) + 1;
+    }
+    return n;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Simple bot strategies (easy-plus)                                   */
+/* ------------------------------------------------------------------------- */
+
+
+/* Easy+ bot: first block immediate wins, then prefer center columns. */
+int bot_pick_easy_plus(const Board *b, Cell bot_player) {
+    ThreatMap tm;
+    board_threat_map(b, &tm);
+
+    Bitboard danger = tm.now[board_player_index(bot_player) ^ 1];
+    if (danger) {
+        return board_bit_column(danger) + 1;
+    }
+
+    static const int pref[COLS] = {4, 3, 5, 2, 6, 1, 7};
+    for (int i = 0; i < COLS; i++) {
+        int c = pref[i];
+        if (tm.playable & board_column_mask(c - 1)) {
+            return c;
+        }
+    }
+
+    return -1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Medium bot helpers (pattern / threat based)                               */
+/* ------------------------------------------------------------------------- */
+
+/* Immediate win for p? Return column 1..7 or -1. */
+int find_self_win_in_1(const Board *b, Cell p) {
+    ThreatMap tm;
+    board_threat_map(b, &tm);
+
+    Bitboard wins = tm.now[board_player_index(p)];
+    return wins ? board_bit_column(wins) + 1 : -1;
+}
+
+/* Line directions as bitboard shifts: horizontal, vertical, both diagonals. */
+static const int LINE_DIRS[4] = { BOARD_H1, 1, BOARD_H1 - 1, BOARD_H1 + 1 };
+
+/* Length of the contiguous line of 'stones' through the single bit m
+   along direction d (at most 3 counted on each side). */
+static int line_len_from(Bitboard stones, Bitboard m, int d) {
+    int cnt = 1;
+
+    Bitboard t = m;
+    for (int i = 1; i < 4 && (t = (t << d) & stones); i++) cnt++;
+    t = m;
+    for (int i = 1; i < 4 && (t = (t >> d) & stones); i++) cnt++;
+
+    return cnt;
+}
+
+/* Count windows of four through m along d that hold three of 'stones'
+   and one empty cell, with an empty on-board cell just before or after
+   the window. */
+static int open_three_through(Bitboard stones, Bitboard mask, Bitboard m, int d) {
+    Bitboard full   = BOARD_FULL_MASK;
+    Bitboard starts = full & (full >> d) & (full >> 2 * d) & (full >> 3 * d);
+    Bitboard empty  = full & ~mask;
+    int total = 0;
+
+    for (int k = 0; k < 4; k++) {
+        Bitboard st = (m >> (k * d)) & starts;
+        if (!st) continue;
+
+        Bitboard win = st | (st << d) | (st << 2 * d) | (st << 3 * d);
+        if ((win & mask & ~stones) || __builtin_popcountll(win & stones) != 3) continue;
+
+        if (((st >> d) | (st << 4 * d)) & empty) {
+            total++;
+        }
+    }
+
+    return total;
+}
+
+/*
+ * Score the move m (a single playable bit) for 'me' without playing it.
+ * tm is the threat map before the move; opp_threats_before the number
+ * of columns where the opponent could win before it.
+ */
+static int score_move(const Board *b, const ThreatMap *tm, Bitboard m,
+                      int me, int opp_threats_before) {
+    Bitboard own      = b->stones[me] | m;
+    Bitboard mask     = board_mask(b) | m;
+    Bitboard playable = board_playable(mask);
+    int best_line = 0;
+    int threes    = 0;
+
+    for (int k = 0; k < 4; k++) {
+        int len = line_len_from(own, m, LINE_DIRS[k]);
+        if (len > best_line) {
+            best_line = len;
+        }
+        threes += open_three_through(own, mask, m, LINE_DIRS[k]);
+    }
+
+    int s = 0;
+
+    s += 100 * best_line;
+    s +=  60 * threes;
+    s +=  40 * __builtin_popcountll(board_winning_cells(own, mask) & playable);
+
+    int opp_threats_after = __builtin_popcountll(tm->cells[me ^ 1] & ~m & playable);
+
+    int removed = (opp_threats_before > opp_threats_after)
+                  ? (opp_threats_before - opp_threats_after)
+                  : 0;
+    s += 25 * removed;
+
+    /* 5 per row above the bottom, counting the landing row as one */
+    s += 5 * (__builtin_ctzll(m) % BOARD_H1 + 1);
+
+    rng_init_once();
+    s += (rand() % 7) - 3;
+
+    return s;
+}
+
+/* Medium bot:
+   - win if possible
+   - best blocking move
+   - best safe move
+   - otherwise best overall (even if risky)
+   Everything is read from one threat map; no move is played. */
+int bot_pick_medium(const Board *b, Cell bot_player) {
+    int       me = board_player_index(bot_player);
+    ThreatMap tm;
+    board_threat_map(b, &tm);
+
+    if (tm.now[me]) {
+        return board_bit_column(tm.now[me]) + 1;
+    }
+
+    int opp_threats_before = __builtin_popcountll(tm.now[me ^ 1]);
+    int cols[COLS];
+    int n;
+
+    int best_block_col   = -1;
+    int best_block_score = INT_MIN;
+
+    n = cells_to_columns(tm.now[me ^ 1], cols);
+    for (int i = 0; i < n; i++) {
+        Bitboard m  = tm.playable & board_column_mask(cols[i] - 1);
+        int      sc = score_move(b, &tm, m, me, opp_threats_before);
+
+        if (sc > best_block_score) {
+            best_block_score = sc;
+            best_block_col   = cols[i];
+        }
+    }
+
+    if (best_block_col != -1) {
+        return best_block_col;
+    }
+
+    int best_col   = -1;
+    int best_score = INT_MIN;
+
+    n = cells_to_columns(tm.playable, cols);
+    for (int i = 0; i < n; i++) {
+        Bitboard m = tm.playable & board_column_mask(cols[i] - 1);
+
+        /* unsafe: the opponent could win right after (possibly on top of m) */
+        Bitboard after = board_playable(board_mask(b) | m);
+        if (tm.cells[me ^ 1] & ~m & after) {
+            continue;
+        }
+
+        int sc = score_move(b, &tm, m, me, opp_threats_before);
+        if (sc > best_score) {
+            best_score = sc;
+            best_col   = cols[i];
+        }
+    }
+
+    if (best_col != -1) {
+        return best_col;
+    }
+
+    best_col   = -1;
+    best_score = INT_MIN;
+
+    for (int i = 0; i < n; i++) {
+        Bitboard m  = tm.playable & board_column_mask(cols[i] - 1);
+        int      sc = score_move(b, &tm, m, me, opp_threats_before);
+
+        if (sc > best_score) {
+            best_score = sc;
+            best_col   = cols[i];
+        }
+    }
+
+    return best_col;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Searching levels                                                          */
+/* ------------------------------------------------------------------------- */
+
+/* What a caller threads into the searching levels; NULL members mean
+   "none". bot_search_start() fills all four. */
+typedef struct {
+    atomic_bool    *stop;
+    SearchProgress *progress;
+    ColumnRanking  *ranking;
+    SearchStats    *stats;
+} BotControl;
+
+static const BotControl NO_CONTROL = { NULL, NULL, NULL, NULL };
+
+static bool control_stopped(const BotControl *ctl) {
+    return ctl->stop && atomic_load(ctl->stop);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Column rankings and their cache                                           */
+/* ------------------------------------------------------------------------- */
+
+/* Direct-mapped cache of recent rankings; a new ranking replaces
+   whatever held its slot. */
+#define RANK_CACHE_SLOTS 256
+
+typedef struct {
+    uint64_t      key;     // 0 = empty
+    ColumnRanking ranking; // in the orientation of the canonical key
+} RankSlot;
+
+static RankSlot        g_rank_cache[RANK_CACHE_SLOTS];
+static pthread_mutex_t g_rank_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
+
+/* Cache key of the position with 'to_move' to play: book_key() with
+   the side folded in. *mirrored tells whether the key is that of the
+   mirror image. */
+static uint64_t rank_key(const Board *b, Cell to_move, bool *mirrored) {
+    Bitboard cur  = b->stones[board_player_index(to_move)];
+    Bitboard mask = board_mask(b);
+
+    uint64_t key    = cur + mask + BOARD_BOTTOM_MASK;
+    uint64_t mirror = board_mirror(cur) + board_mirror(mask) + BOARD_BOTTOM_MASK;
+
+    *mirrored = (mirror < key);
+    return (((*mirrored) ? mirror : key) << 1) | (to_move == CELL_B);
+}
+
+static void ranking_mirror(ColumnRanking *r) {
+    for (int c = 0; c < COLS / 2; c++) {
+        int m = COLS - 1 - c;
+        int t;
+        t = r->col_score[c]; r->col_score[c] = r->col_score[m]; r->col_score[m] = t;
+        t = r->col_plies[c]; r->col_plies[c] = r->col_plies[m]; r->col_plies[m] = t;
+    }
+    if (r->best_col > 0) {
+        r->best_col = COLS + 1 - r->best_col;
+    }
+}
+
+static bool rank_cache_get(const Board *b, Cell to_move, ColumnRanking *out) {
+    bool     mirrored;
+    uint64_t key  = rank_key(b, to_move, &mirrored);
+    RankSlot *slot = &g_rank_cache[(key * 0x9E3779B97F4A7C15ULL) >> 56];
+    bool     hit;
+
+    pthread_mutex_lock(&g_rank_lock);
+    hit = (slot->key == key);
+    if (hit) {
+        *out = slot->ranking;
+    }
+    pthread_mutex_unlock(&g_rank_lock);
+
+    if (hit) {
+        if (mirrored) {
+            ranking_mirror(out);
+        }
+        out->cached = true;
+    }
+    return hit;
+}
+
+static void rank_cache_put(const Board *b, Cell to_move, const ColumnRanking *r) {
+    bool     mirrored;
+    uint64_t key  = rank_key(b, to_move, &mirrored);
+    RankSlot *slot = &g_rank_cache[(key * 0x9E3779B97F4A7C15ULL) >> 56];
+
+    ColumnRanking stored = *r;
+    stored.cached = false;
+    if (mirrored) {
+        ranking_mirror(&stored);
+    }
+
+    pthread_mutex_lock(&g_rank_lock);
+    slot->key     = key;
+    slot->ranking = stored;
+    pthread_mutex_unlock(&g_rank_lock);
+}
+
+/* Exact ranking from solved column scores (SOLVER_INVALID = full). */
+static void ranking_from_solved(const Board *b, const int col_score[COLS],
+                                ColumnRanking *out) {
+    int moves = __builtin_popcountll(board_mask(b));
+
+    out->exact    = true;
+    out->best_col = -1;
+    out->depth    = 0;
+    out->cached   = false;
+
+    for (int c = 0; c < COLS; c++) {
+        bool legal = (col_score[c] != SOLVER_INVALID);
+        out->col_score[c] = legal ? col_score[c] : BOT_NO_SCORE;
+        out->col_plies[c] = legal ? solver_plies_to_end(col_score[c], moves) : 0;
+    }
+    for (int i = 0; i < COLS; i++) {
+        int col = ORDER[i];
+        if (out->col_score[col - 1] == BOT_NO_SCORE) continue;
+        if (out->best_col == -1 || out->col_score[col - 1] > out->col_score[out->best_col - 1]) {
+            out->best_col = col;
+        }
+    }
+}
+
+/* The book or solver ranking of b, if either settles it in budget. */
+static bool rank_exact(const Board *b, Cell to_move, const BotControl *ctl,
+                       ColumnRanking *out) {
+    int col_score[COLS];
+
+    if (!book_column_scores(book_default(), b, to_move, col_score)) {
+        SolverLimits limits = PERFECT_LIMITS;
+        SolverResult res;
+        limits.cancel = ctl->stop;
+        bool solved = solver_solve(b, to_move, &limits, &res);
+        if (ctl->stats) {
+            ctl->stats->nodes           = res.nodes;
+            ctl->stats->thread_nodes[0] = res.nodes;
+            ctl->stats->threads         = 1;
+            ctl->stats->elapsed_ms      = res.elapsed_ms;
+        }
+        if (!solved) {
+            return false;
+        }
+        for (int c = 0; c < COLS; c++) {
+            col_score[c] = res.col_score[c];
+        }
+    }
+
+    ranking_from_solved(b, col_score, out);
+    return out->best_col != -1;
+}
+
+static int rank_columns(const Board *b, Cell to_move, const BotControl *ctl,
+                        ColumnRanking *out) {
+    if (rank_cache_get(b, to_move, out)) {
+        return out->best_col;
+    }
+
+    if (!rank_exact(b, to_move, ctl, out)) {
+        SearchLimits  limits = HARD_LIMITS;
+        SearchRanking sr;
+        limits.cancel   = ctl->stop;
+        limits.progress = ctl->progress;
+        search_rank_columns(b, to_move, &limits, &sr);
+        if (ctl->stats) {
+            *ctl->stats = sr.stats;
+        }
+
+        out->exact    = false;
+        out->best_col = sr.best_col;
+        out->depth    = sr.depth;
+        out->cached   = false;
+        for (int c = 0; c < COLS; c++) {
+            out->col_score[c] = sr.col_score[c];
+            out->col_plies[c] = sr.col_plies[c];
+        }
+    }
+
+    /* A ranking cut short by the caller is not worth keeping. */
+    if (out->best_col != -1 && !control_stopped(ctl)) {
+        rank_cache_put(b, to_move, out);
+    }
+    return out->best_col;
+}
+
+int bot_rank_columns(const Board *b, Cell to_move, ColumnRanking *out) {
+    return rank_columns(b, to_move, &NO_CONTROL, out);
+}
+
+/* Depth the hard search would reach on b if time allowed: its depth
+   limit, or every empty cell when it has none. */
+static int hard_full_depth(const Board *b) {
+    int empty = ROWS * COLS - __builtin_popcountll(board_mask(b));
+    return (HARD_LIMITS.max_depth > 0 && HARD_LIMITS.max_depth < empty)
+           ? HARD_LIMITS.max_depth : empty;
+}
+
+/* Hard level: book move in the opening, take/block immediate wins,
+   then a cached ranking if it is exact or as deep as the search would
+   go, otherwise search. */
+static int pick_hard(const Board *b, Cell bot_player, const BotControl *ctl) {
+    Cell opp = (bot_player == CELL_A) ? CELL_B : CELL_A;
+
+    int book_col;
+    if (book_best_move(book_default(), b, bot_player, &book_col, NULL)) {
+        return book_col;
+    }
+
+    int win_col = find_self_win_in_1(b, bot_player);
+    if (win_col != -1) {
+        return win_col;
+    }
+
+    int block_col = find_self_win_in_1(b, opp);
+    if (block_col != -1) {
+        return block_col;
+    }
+
+    ColumnRanking cached;
+    if (rank_cache_get(b, bot_player, &cached) &&
+        (cached.exact || cached.depth >= hard_full_depth(b))) {
+        return cached.best_col;
+    }
+
+    SearchLimits limits = HARD_LIMITS;
+    SearchResult res;
+    limits.cancel   = ctl->stop;
+    limits.progress = ctl->progress;
+    search_best_move(b, bot_player, &limits, &res);
+    if (ctl->stats) {
+        *ctl->stats = res.stats;
+    }
+    return res.best_col;
+}
+
+/* Perfect level: the best column of the book or solver ranking (or
+   of a cached one), the hard level if the solve runs over budget.
+   Exact rankings go to ctl->ranking and the ranking cache. */
+static int pick_perfect(const Board *b, Cell bot_player, const BotControl *ctl) {
+    ColumnRanking rank;
+
+    bool exact = (rank_cache_get(b, bot_player, &rank) && rank.exact);
+    if (!exact && rank_exact(b, bot_player, ctl, &rank)) {
+        exact = true;
+        rank_cache_put(b, bot_player, &rank);
+    }
+    if (!exact) {
+        return pick_hard(b, bot_player, ctl);
+    }
+
+    if (ctl->ranking) {
+        *ctl->ranking = rank;
+    }
+    return rank.best_col;
+}
+
+/* Monte Carlo level: take an immediate win, otherwise let the tree
+   search decide. Blocks are left to the search, so the kept tree
+   follows the game. */
+static int pick_mcts(const Board *b, Cell bot_player, const BotControl *ctl) {
+    int win_col = find_self_win_in_1(b, bot_player);
+    if (win_col != -1) {
+        return win_col;
+    }
+
+    MctsLimits limits = MCTS_LIMITS;
+    limits.cancel   = ctl->stop;
+    limits.progress = ctl->progress;
+    return mcts_best_move(b, bot_player, &limits, NULL);
+}
+
+static int pick(const Board *b, BotDifficulty d, Cell bot_player, const BotControl *ctl) {
+    switch (d) {
+        case BOT_EASY:
+            return bot_pick_easy_plus(b, bot_player);
+        case BOT_MEDIUM:
+            return bot_pick_medium(b, bot_player);
+        case BOT_HARD:
+            return pick_hard(b, bot_player, ctl);
+        case BOT_PERFECT:
+            return pick_perfect(b, bot_player, ctl);
+        case BOT_MCTS:
+            return pick_mcts(b, bot_player, ctl);
+        default:
+            return bot_pick_easy_plus(b, bot_player);
+    }
+}
+
+int bot_pick_hard(const Board *b, Cell bot_player) {
+    return pick_hard(b, bot_player, &NO_CONTROL);
+}
+
+int bot_pick_perfect(const Board *b, Cell bot_player) {
+    return pick_perfect(b, bot_player, &NO_CONTROL);
+}
+
+int bot_pick_mcts(const Board *b, Cell bot_player) {
+    return pick_mcts(b, bot_player, &NO_CONTROL);
+}
+
+int bot_pick_dispatch(const Board *b, BotDifficulty d, Cell bot_player) {
+    return pick(b, d, bot_player, &NO_CONTROL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Asynchronous move                                                         */
+/* ------------------------------------------------------------------------- */
+
+static void bot_search_main(void *arg) {
+    BotSearch *s   = (BotSearch*)arg;
+    BotControl ctl = { &s->stop, &s->progress, &s->ranking, &s->stats };
+
+    TRACE_BEGIN_ARG(s->hint ? "hint" : "bot_search", s->diff);
+    if (s->hint) {
+        s->result_col = rank_columns(&s->snapshot, s->player, &ctl, &s->ranking);
+    } else {
+        s->result_col = pick(&s->snapshot, s->diff, s->player, &ctl);
+    }
+    TRACE_END(s->hint ? "hint" : "bot_search");
+
+    /* Levels that do not search still leave their move in progress. */
+    if (atomic_load(&s->progress.updates) == 0 && s->result_col > 0) {
+        search_progress_publish(&s->progress, s->result_col, 0, 0, 0);
+    }
+}
+
+static void search_start(BotSearch *s, const Board *b, BotDifficulty d,
+                         Cell player, bool hint) {
+    s->snapshot         = *b;
+    s->diff             = d;
+    s->player           = player;
+    s->hint             = hint;
+    s->result_col       = -1;
+    s->ranking.best_col = -1;
+    memset(&s->stats, 0, sizeof(s->stats));
+    atomic_init(&s->stop, false);
+    search_progress_init(&s->progress);
+
+    s->pool = pool_default();
+    if (s->pool) {
+        pool_submit(s->pool, &s->task, bot_search_main, s);
+    } else {
+        bot_search_main(s);
+    }
+}
+
+void bot_search_start(BotSearch *s, const Board *b, BotDifficulty d, Cell bot_player) {
+    search_start(s, b, d, bot_player, false);
+}
+
+void bot_hint_start(BotSearch *s, const Board *b, Cell to_move) {
+    search_start(s, b, BOT_PERFECT, to_move, true);
+}
+
+bool bot_search_poll(const BotSearch *s) {
+    return !s->pool || pool_done(&s->task);
+}
+
+int bot_search_wait(BotSearch *s) {
+    if (s->pool) {
+        pool_wait(s->pool, &s->task);
+    }
+    return s->result_col;
+}
+
+void bot_search_stop(BotSearch *s) {
+    atomic_store(&s->stop, true);
+}
@@ -0,0 +1,358 @@
+#include "eval.h"
+#include <string.h>    // memset, strcmp
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define EVAL_HAVE_AVX2 1
+#endif
+
+/* Most windows through one cell: 4 per direction, fewer near edges. */
+#define EVAL_MAX_CELL_WINDOWS 16
+
+/* Score a window of 4 cells from the view of 'me'. */
+static int eval_window(Cell c1, Cell c2, Cell c3, Cell c4, Cell me) {
+    Cell opp = (me == CELL_A) ? CELL_B : CELL_A;
+    Cell cells[4] = { c1, c2, c3, c4 };
+
+    int me_count    = 0;
+    int opp_count   = 0;
+    int empty_count = 0;
+
+    for (int i = 0; i < 4; i++) {
+        if (cells[i] == me) {
+            me_count++;
+        } else if (cells[i] == opp) {
+            opp_count++;
+        } else if (cells[i] == CELL_EMPTY) {
+            empty_count++;
+        }
+    }
+
+    if (me_count > 0 && opp_count > 0) {
+        return 0;
+    }
+
+    int score = 0;
+
+    if (me_count == 3 && empty_count == 1)      score += 100;
+    else if (me_count == 2 && empty_count == 2) score += 10;
+    else if (me_count == 1 && empty_count == 3) score += 1;
+
+    if (opp_count == 3 && empty_count == 1)      score -= 120;
+    else if (opp_count == 2 && empty_count == 2) score -= 8;
+    else if (opp_count == 1 && empty_count == 3) score -= 1;
+
+    return score;
+}
+
+/* Heuristic board score from the view of 'me', one eval_window() per window. */
+int evaluate_board_reference(const Board *b, Cell me) {
+    Cell opp = (me == CELL_A) ? CELL_B : CELL_A;
+    int score = 0;
+
+    int center_col = COLS / 2;
+    for (int r = 0; r < ROWS; r++) {
+        if (board_cell(b, r, center_col) == me) score += EVAL_CENTER;
+        else if (board_cell(b, r, center_col) == opp) score -= EVAL_CENTER;
+    }
+
+    for (int r = 0; r < ROWS; r++) {
+        for (int c = 0; c <= COLS - 4; c++) {
+            score += eval_window(board_cell(b, r, c),
+                                 board_cell(b, r, c+1),
+                                 board_cell(b, r, c+2),
+                                 board_cell(b, r, c+3),
+                                 me);
+        }
+    }
+
+    for (int c = 0; c < COLS; c++) {
+        for (int r = 0; r <= ROWS - 4; r++) {
+            score += eval_window(board_cell(b, r, c),
+                                 board_cell(b, r+1, c),
+                                 board_cell(b, r+2, c),
+                                 board_cell(b, r+3, c),
+                                 me);
+        }
+    }
+
+    for (int r = 0; r <= ROWS - 4; r++) {
+        for (int c = 0; c <= COLS - 4; c++) {
+            score += eval_window(board_cell(b, r, c),
+                                 board_cell(b, r+1, c+1),
+                                 board_cell(b, r+2, c+2),
+                                 board_cell(b, r+3, c+3),
+                                 me);
+        }
+    }
+
+    for (int r = 3; r < ROWS; r++) {
+        for (int c = 0; c <= COLS - 4; c++) {
+            score += eval_window(board_cell(b, r, c),
+                                 board_cell(b, r-1, c+1),
+                                 board_cell(b, r-2, c+2),
+                                 board_cell(b, r-3, c+3),
+                                 me);
+        }
+    }
+
+    return score;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Incremental evaluation                                                    */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * window_score[m][o]: eval_window() of a window holding m pieces of
+ * 'me' and o of the opponent; cell_windows lists the windows through
+ * each bitboard bit. Both are filled once by eval_tables_init().
+ */
+static int     window_score[5][5];
+static uint8_t cell_windows[ROWS * COLS + COLS][EVAL_MAX_CELL_WINDOWS];
+static uint8_t cell_window_count[ROWS * COLS + COLS];
+
+static void eval_select_kernel(void);
+
+/* Runs before main(), so the tables and the kernel are ready for every
+   caller and the hot paths need no once-check. */
+__attribute__((constructor))
+static void eval_tables_init(void) {
+    for (int m = 0; m <= 4; m++) {
+        for (int o = 0; m + o <= 4; o++) {
+            Cell w[4];
+            for (int i = 0; i < 4; i++) {
+                w[i] = (i < m) ? CELL_A : (i < m + o) ? CELL_B : CELL_EMPTY;
+            }
+            window_score[m][o] = eval_window(w[0], w[1], w[2], w[3], CELL_A);
+        }
+    }
+
+    /* Windows as (start column, start height, column step, height step). */
+    static const int DIRS[4][2] = { {1, 0}, {0, 1}, {1, 1}, {1, -1} };
+    int w = 0;
+
+    for (int d = 0; d < 4; d++) {
+        int dc = DIRS[d][0];
+        int dh = DIRS[d][1];
+        for (int c = 0; c < COLS; c++) {
+            for (int h = 0; h < ROWS; h++) {
+                int ec = c + 3 * dc;
+                int eh = h + 3 * dh;
+                if (ec < 0 || ec >= COLS || eh < 0 || eh >= ROWS) continue;
+
+                for (int i = 0; i < 4; i++) {
+                    int bit = (c + i * dc) * BOARD_H1 + (h + i * dh);
+                    cell_windows[bit][cell_window_count[bit]++] = (uint8_t)w;
+                }
+                w++;
+            }
+        }
+    }
+
+    eval_select_kernel();
+}
+
+/* A piece of player index p was added (sign = 1) or removed (sign = -1)
+   on bitboard bit 'bit'. */
+static void eval_state_update(EvalState *e, int p, int bit, int sign) {
+    uint8_t *own = e->window_count[p];
+    uint8_t *opp = e->window_count[p ^ 1];
+    int      ds  = 0;   // change of p's score
+    int      dso = 0;   // change of the opponent's score
+
+    for (int i = 0; i < cell_window_count[bit]; i++) {
+        int w = cell_windows[bit][i];
+        int m = own[w];
+        int o = opp[w];
+        int n = m + sign;
+
+        ds  += window_score[n][o] - window_score[m][o];
+        dso += window_score[o][n] - window_score[o][m];
+        own[w] = (uint8_t)n;
+    }
+
+    if (bit / BOARD_H1 == COLS / 2) {
+        ds  += sign * EVAL_CENTER;
+        dso -= sign * EVAL_CENTER;
+    }
+
+    e->score[p]     += ds;
+    e->score[p ^ 1] += dso;
+}
+
+void eval_state_init(EvalState *e, const Board *b) {
+    memset(e, 0, sizeof(*e));
+
+    for (int p = 0; p < 2; p++) {
+        for (Bitboard x = b->stones[p]; x; x &= x - 1) {
+            eval_state_update(e, p, __builtin_ctzll(x), 1);
+        }
+    }
+}
+
+void eval_state_push(EvalState *e, const Board *b) {
+    int bit = board_last_bit(b);
+    eval_state_update(e, (int)((b->stones[1] >> bit) & 1), bit, 1);
+}
+
+void eval_state_pop(EvalState *e, const Board *b) {
+    int bit = board_last_bit(b);
+    eval_state_update(e, (int)((b->stones[1] >> bit) & 1), bit, -1);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Branch-free full scan                                                     */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * A window only scores when one player has no piece in it, and then by
+ * how many pieces the other has. The kernels count, for each direction
+ * at once, the windows holding exactly k pieces of a player and none of
+ * the opponent's:
+ *   - window start bits whose four cells are all playable, from
+ *     BOARD_FULL_MASK shifted onto itself (the sentinel bit breaks the
+ *     vertical and diagonal wraps)
+ *   - the four cells of every window as the stones shifted by 0, d, 2d
+ *     and 3d, summed bit-sliced into masks for 1, 2, 3 and 4 pieces
+ * Scores then come from window_score[][] with no per-window branches.
+ */
+
+/* Window start bits for direction d (7, 1, 8 or 6). */
+static inline Bitboard eval_window_starts(int d) {
+    Bitboard f = BOARD_FULL_MASK;
+    return f & (f >> d) & (f >> 2 * d) & (f >> 3 * d);
+}
+
+static void eval_count_scalar(Bitboard a, Bitboard b, EvalCounts *out) {
+    static const int DIR[4] = { BOARD_H1, 1, BOARD_H1 + 1, BOARD_H1 - 1 };
+    Bitboard stones[2] = { a, b };
+
+    memset(out, 0, sizeof(*out));
+
+    for (int i = 0; i < 4; i++) {
+        int      d      = DIR[i];
+        Bitboard starts = eval_window_starts(d);
+
+        for (int p = 0; p < 2; p++) {
+            Bitboard x = stones[p];
+            Bitboard o = stones[p ^ 1];
+            Bitboard open = starts & ~(o | (o >> d) | (o >> 2 * d) | (o >> 3 * d));
+
+            Bitboard x0 = x, x1 = x >> d, x2 = x >> 2 * d, x3 = x >> 3 * d;
+            Bitboard s1 = x0 ^ x1, c1 = x0 & x1;
+            Bitboard s2 = x2 ^ x3, c2 = x2 & x3;
+            Bitboard lo = s1 ^ s2, cy = s1 & s2;
+            Bitboard mid  = c1 ^ c2 ^ cy;
+            Bitboard high = (c1 & c2) | (c1 & cy) | (c2 & cy);
+
+            out->n[p][1] += __builtin_popcountll(open & lo & ~mid & ~high);
+            out->n[p][2] += __builtin_popcountll(open & ~lo & mid);
+            out->n[p][3] += __builtin_popcountll(open & lo & mid);
+            out->n[p][4] += __builtin_popcountll(open & high);
+        }
+    }
+}
+
+#ifdef EVAL_HAVE_AVX2
+/* Same counts with the four directions in the four 64-bit lanes. */
+__attribute__((target("avx2,popcnt")))
+static void eval_count_avx2(Bitboard a, Bitboard b, EvalCounts *out) {
+    const __m256i d1 = _mm256_setr_epi64x(BOARD_H1, 1, BOARD_H1 + 1, BOARD_H1 - 1);
+    const __m256i d2 = _mm256_add_epi64(d1, d1);
+    const __m256i d3 = _mm256_add_epi64(d2, d1);
+    const __m256i starts = _mm256_setr_epi64x(
+        (long long)eval_window_starts(BOARD_H1),     (long long)eval_window_starts(1),
+        (long long)eval_window_starts(BOARD_H1 + 1), (long long)eval_window_starts(BOARD_H1 - 1));
+    Bitboard stones[2] = { a, b };
+
+    for (int p = 0; p < 2; p++) {
+        __m256i x = _mm256_set1_epi64x((long long)stones[p]);
+        __m256i o = _mm256_set1_epi64x((long long)stones[p ^ 1]);
+
+        __m256i oany = _mm256_or_si256(
+            _mm256_or_si256(o, _mm256_srlv_epi64(o, d1)),
+            _mm256_or_si256(_mm256_srlv_epi64(o, d2), _mm256_srlv_epi64(o, d3)));
+        __m256i open = _mm256_andnot_si256(oany, starts);
+
+        __m256i x1 = _mm256_srlv_epi64(x, d1);
+        __m256i x2 = _mm256_srlv_epi64(x, d2);
+        __m256i x3 = _mm256_srlv_epi64(x, d3);
+        __m256i s1 = _mm256_xor_si256(x, x1),  c1 = _mm256_and_si256(x, x1);
+        __m256i s2 = _mm256_xor_si256(x2, x3), c2 = _mm256_and_si256(x2, x3);
+        __m256i lo = _mm256_xor_si256(s1, s2), cy = _mm256_and_si256(s1, s2);
+        __m256i mid  = _mm256_xor_si256(_mm256_xor_si256(c1, c2), cy);
+        __m256i high = _mm256_or_si256(_mm256_and_si256(c1, c2),
+                                       _mm256_and_si256(_mm256_or_si256(c1, c2), cy));
+
+        __m256i k[4];
+        k[0] = _mm256_and_si256(open, _mm256_andnot_si256(_mm256_or_si256(mid, high), lo));
+        k[1] = _mm256_and_si256(open, _mm256_andnot_si256(lo, mid));
+        k[2] = _mm256_and_si256(open, _mm256_and_si256(lo, mid));
+        k[3] = _mm256_and_si256(open, high);
+
+        for (int j = 0; j < 4; j++) {
+            uint64_t lane[4];
+            _mm256_storeu_si256((__m256i*)lane, k[j]);
+            out->n[p][j + 1] = __builtin_popcountll(lane[0]) + __builtin_popcountll(lane[1]) +
+                               __builtin_popcountll(lane[2]) + __builtin_popcountll(lane[3]);
+        }
+        out->n[p][0] = 0;
+    }
+}
+#endif
+
+static EvalCountFn g_eval_count = eval_count_scalar;
+static const char *g_eval_count_name = "scalar";
+
+/* Pick the widest kernel the CPU supports (called once by eval_tables_init()). */
+static void eval_select_kernel(void) {
+#ifdef EVAL_HAVE_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        g_eval_count      = eval_count_avx2;
+        g_eval_count_name = "avx2";
+    }
+#endif
+}
+
+EvalCountFn eval_count_kernel(const char *name) {
+    if (strcmp(name, "scalar") == 0) {
+        return eval_count_scalar;
+    }
+#ifdef EVAL_HAVE_AVX2
+    if (strcmp(name, "avx2") == 0 &&
+        __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return eval_count_avx2;
+    }
+#endif
+    return NULL;
+}
+
+const char *eval_count_kernel_name(void) {
+    return g_eval_count_name;
+}
+
+int eval_score_counts(const EvalCounts *c, Bitboard center_own, Bitboard center_opp, int p) {
+    int score = EVAL_CENTER * (__builtin_popcountll(center_own) - __builtin_popcountll(center_opp));
+    for (int k = 1; k <= 4; k++) {
+        score += window_score[k][0] * c->n[p][k] + window_score[0][k] * c->n[p ^ 1][k];
+    }
+    return score;
+}
+
+void eval_window_weights(int own[5], int opp[5]) {
+    for (int k = 0; k <= 4; k++) {
+        own[k] = window_score[k][0];
+        opp[k] = window_score[0][k];
+    }
+}
+
+int evaluate_board_scan(const Board *b, Cell me) {
+    int        p      = board_player_index(me);
+    Bitboard   center = board_column_mask(COLS / 2);
+    EvalCounts counts;
+
+    g_eval_count(b->stones[0], b->stones[1], &counts);
+    return eval_score_counts(&counts, b->stones[p] & center, b->stones[p ^ 1] & center, p);
+}
@@ -1,44 +1,38 @@
 #define _XOPEN_SOURCE 700
 
 #include "game.h"
+#include "book.h"
+#include "bot.h"
+#include "eval.h"
+#include "mcts.h"
+#include "ponder.h"
+#include "pool.h"
+#include "search.h"
+#include "solver.h"
+#include "trace.h"
 #include <stdio.h>
-#include <stdlib.h>    // rand, srand
-#include <time.h>      // time
-#include <limits.h>    // INT_MIN
-#include <pthread.h>
+#include <stdlib.h>    // getenv
 #include <string.h>    // memcpy, strlen, strcmp, etc.
-#include <unistd.h>    // usleep, close
+#include <poll.h>      // poll
+#include <unistd.h>    // close, isatty
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>     // gethostbyname
 
-/* Forward declarations for the minimax-based evaluation. */
-static int evaluate_board(const Board *b, Cell me);
-static int minimax_ab(const Board *b, int depth, int alpha, int beta,
-                      Cell bot, Cell current_player, int last_row, int last_col);
-
 /* ------------------------------------------------------------------------- */
 /* Basic input / utility helpers                                             */
 /* ------------------------------------------------------------------------- */
 
-/* Initialize the random number generator once per program run. */
-static void rng_init_once(void) {
-    static int init = 0;
-    if (!init) {
-        srand((unsigned)time(NULL));
-        init = 1;
-    }
-}
-
 // Read a column number 1..7, 'h' for hint, 'u' for undo, or 'q' to quit.
+// In trace builds, 't' writes the trace recorded so far and asks again.
 // Returns 1 if a command/column was read into *out_col,
 // returns 0 if the user asked to quit (q/Q or EOF).
 // Special values in *out_col:
 //   -1 => hint
 //   -2 => undo
-static int read_column_or_quit(int *out_col) {
+static int read_column_raw(int *out_col) {
     int ch;
 
     while (1) {
@@ -69,6 +63,14 @@ static int read_column_or_quit(int *out_col) {
             return 1;
         }
 
+#ifdef CONNECT4_TRACE
+        if (ch == 't' || ch == 'T') {
+            while (ch != '\n' && ch != EOF) ch = getchar();
+            trace_dump_default();
+            continue;
+        }
+#endif
+
         if (ch == '\n' || ch == '\r') {
             continue;
         }
@@ -94,640 +96,317 @@ static int read_column_or_quit(int *out_col) {
     }
 }
 
-
-/* Collect all currently playable columns (1..7). */
-static int collect_valid_columns(const Board *b, int cols_out[COLS]) {
-    int n = 0;
-    for (int c = 1; c <= COLS; c++) {
-        int h = b->heights[c - 1];
-        if (h < ROWS) {
-            cols_out[n++] = c;
-        }
-    }
-    return n;
-}
-
-/* Copy a board struct. */
-static void board_clone(Board *dst, const Board *src) {
-    memcpy(dst, src, sizeof(*dst));
-}
-
-/* Simulate dropping p in column col and test if that move wins. */
-static int would_win_if_drop(const Board *b, int col, Cell p) {
-    Board tmp;
-    memcpy(&tmp, b, sizeof(tmp));
-    int placed_row;
-    if (!board_drop(&tmp, col, p, &placed_row)) {
-        return 0;
-    }
-    return board_is_winning(&tmp, placed_row, col - 1, p);
-}
-
-/* List all columns where the opponent would win immediately. */
-static int opponent_winning_cols(const Board *b, Cell opponent, int out[COLS]) {
-    int n = 0;
-    for (int col = 1; col <= COLS; col++) {
-        if (b->heights[col - 1] >= ROWS) {
-            continue;
-        }
-        if (would_win_if_drop(b, col, opponent)) {
-            out[n++] = col;
-        }
-    }
-    return n;
-}
-
-/* ------------------------------------------------------------------------- */
-/* Simple bot strategies (easy-plus)                                   */
-/* ------------------------------------------------------------------------- */
-
-
-/* Easy+ bot: first block immediate wins, then prefer center columns. */
-static int bot_pick_easy_plus(const Board *b, Cell bot_player) {
-    Cell opp = (bot_player == CELL_A) ? CELL_B : CELL_A;
-
-    int danger[COLS];
-    int dn = opponent_winning_cols(b, opp, danger);
-    if (dn > 0) {
-        return danger[0];
-    }
-
-    static const int pref[COLS] = {4, 3, 5, 2, 6, 1, 7};
-    for (int i = 0; i < COLS; i++) {
-        int c = pref[i];
-        if (b->heights[c - 1] < ROWS) {
-            return c;
-        }
-    }
-
-    return -1;
+/* read_column_raw(), traced as the time spent waiting for the user. */
+static int read_column_or_quit(int *out_col) {
+    TRACE_BEGIN("input");
+    int got = read_column_raw(out_col);
+    TRACE_END("input");
+    return got;
 }
 
 /* ------------------------------------------------------------------------- */
-/* Medium bot helpers (pattern / threat based)                               */
+/* Engine tasks (run on the shared thread pool)                              */
 /* ------------------------------------------------------------------------- */
 
-/* Immediate win for p? Return column 1..7 or -1. */
-static int find_self_win_in_1(const Board *b, Cell p) {
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-        if (would_win_if_drop(b, col, p)) return col;
-    }
-    return -1;
-}
+/* How await_engine() ended. */
+typedef enum {
+    ENGINE_DONE,       // the search finished on its own
+    ENGINE_QUIT,       // the user pressed q: search stopped
+    ENGINE_PEER_LOST   // the online peer hung up: search stopped
+} EngineWait;
 
-/* Test if dropping in col for bot_player avoids giving opponent win-in-1. */
-static int move_is_safe_for(const Board *b, int col, Cell bot_player) {
-    Board tmp;
-    memcpy(&tmp, b, sizeof(tmp));
+/* Status-line refresh and input check period while an engine runs. */
+#define ENGINE_POLL_MS 50
 
-    int placed_row;
-    if (!board_drop(&tmp, col, bot_player, &placed_row)) {
-        return 0;
-    }
-
-    Cell opp = (bot_player == CELL_A) ? CELL_B : CELL_A;
-    int threats[COLS];
-    return opponent_winning_cols(&tmp, opp, threats) == 0;
-}
+/* Print the search's latest progress on one status line. */
+static void show_progress(const BotSearch *s, const char *label) {
+    int col   = atomic_load(&s->progress.best_col);
+    int depth = atomic_load(&s->progress.depth);
+    int score = atomic_load(&s->progress.score);
 
-/* Count a contiguous line through (r,c) along (dr,dc). */
-static int line_len_from(const Board *b, int r, int c, Cell p, int dr, int dc) {
-    int cnt = 1;
-
-    for (int i = 1; i < 4; i++) {
-        int rr = r + dr * i;
-        int cc = c + dc * i;
-        if (rr < 0 || rr >= ROWS || cc < 0 || cc >= COLS) break;
-        if (b->grid[rr][cc] != p) break;
-        cnt++;
+    if (col < 1) {
+        return;
     }
-
-    for (int i = 1; i < 4; i++) {
-        int rr = r - dr * i;
-        int cc = c - dc * i;
-        if (rr < 0 || rr >= ROWS || cc < 0 || cc >= COLS) break;
-        if (b->grid[rr][cc] != p) break;
-        cnt++;
+    if (s->diff == BOT_MCTS) {
+        printf("\r%s thinking: column %d, win %.1f%%, %llu playouts   ",
+               label, col, score / 10.0,
+               (unsigned long long)atomic_load(&s->progress.work));
+    } else {
+        printf("\r%s thinking: depth %d, column %d, score %+d   ",
+               label, depth, col, score);
     }
-
-    return cnt;
+    fflush(stdout);
 }
 
-/* Count open three-in-a-row patterns that include (r,c). */
-static int open_three_through(const Board *b, int r, int c, Cell p) {
-    static const int D[4][2] = { {0,1}, {1,0}, {1,1}, {1,-1} };
-    int total = 0;
-
-    for (int k = 0; k < 4; k++) {
-        int dr = D[k][0];
-        int dc = D[k][1];
-
-        for (int s = -3; s <= 0; s++) {
-            int cnt = 0;
-            int has_me = 0;
-            int openL = 0;
-            int openR = 0;
-
-            for (int i = 0; i < 4; i++) {
-                int rr = r + (s + i) * dr;
-                int cc = c + (s + i) * dc;
-
-                if (rr < 0 || rr >= ROWS || cc < 0 || cc >= COLS) {
-                    cnt = -99;
-                    break;
-                }
+/*
+ * Wait for a bot search while the user (and the online peer) stay in
+ * charge: on a terminal the search's progress is shown on a status
+ * line and a line starting with 'q' stops it; an online peer that
+ * hangs up (peer_fd >= 0) stops it too. Other input typed meanwhile
+ * is discarded. The search has always finished on return.
+ */
+static EngineWait await_engine(BotSearch *s, const char *label, int peer_fd) {
+    bool       watch_stdin = isatty(STDIN_FILENO);
+    bool       live        = isatty(STDOUT_FILENO);
+    bool       shown       = false;
+    unsigned   seen        = 0;
+    EngineWait why         = ENGINE_DONE;
+
+    while (!bot_search_poll(s)) {
+        struct pollfd fds[2];
+        int nfds = 0, in_idx = -1, peer_idx = -1;
+
+        if (watch_stdin) {
+            in_idx = nfds;
+            fds[nfds++] = (struct pollfd){ .fd = STDIN_FILENO, .events = POLLIN };
+        }
+        if (peer_fd >= 0) {
+            peer_idx = nfds;
+            fds[nfds++] = (struct pollfd){ .fd = peer_fd, .events = POLLIN };
+        }
 
-                Cell q = b->grid[rr][cc];
-                if (rr == r && cc == c) {
-                    has_me = 1;
-                }
-                if (q == p) {
-                    cnt++;
-                } else if (q != CELL_EMPTY) {
-                    cnt = -99;
-                    break;
+        if (poll(fds, (nfds_t)nfds, ENGINE_POLL_MS) > 0) {
+            if (in_idx >= 0 && fds[in_idx].revents) {
+                int ch = getchar();
+                int first = ch;
+                while (ch != '\n' && ch != EOF) ch = getchar();
+                if (first == EOF) {
+                    watch_stdin = false;
+                } else if (first == 'q' || first == 'Q') {
+                    why = ENGINE_QUIT;
                 }
             }
-
-            if (cnt == 3 && has_me) {
-                int Lr = r + (s - 1) * dr;
-                int Lc = c + (s - 1) * dc;
-                int Rr = r + (s + 4) * dr;
-                int Rc = c + (s + 4) * dc;
-
-                if (Lr >= 0 && Lr < ROWS && Lc >= 0 && Lc < COLS &&
-                    b->grid[Lr][Lc] == CELL_EMPTY) {
-                    openL = 1;
-                }
-                if (Rr >= 0 && Rr < ROWS && Rc >= 0 && Rc < COLS &&
-                    b->grid[Rr][Rc] == CELL_EMPTY) {
-                    openR = 1;
-                }
-
-                if (openL || openR) {
-                    total++;
+            if (peer_idx >= 0 && fds[peer_idx].revents) {
+                /* The peer sends nothing during our turn: readable means EOF. */
+                char c;
+                if (recv(peer_fd, &c, 1, MSG_PEEK) <= 0) {
+                    why = ENGINE_PEER_LOST;
+                } else {
+                    peer_fd = -1;
                 }
             }
-        }
-    }
-
-    return total;
-}
-
-/* Count how many immediate winning moves 'me' has. */
-static int count_our_immediate_wins(const Board *b, Cell me) {
-    int wins = 0;
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-        if (would_win_if_drop(b, col, me)) {
-            wins++;
-        }
-    }
-    return wins;
-}
-
-/* Score a hypothetical move after it has been played. */
-static int score_move(const Board *after, int placed_row, int placed_col0,
-                      Cell me, Cell opp, int opp_threats_before) {
-    static const int D[4][2] = { {0,1}, {1,0}, {1,1}, {1,-1} };
-    int best_line = 0;
-
-    for (int k = 0; k < 4; k++) {
-        int len = line_len_from(after, placed_row, placed_col0,
-                                me, D[k][0], D[k][1]);
-        if (len > best_line) {
-            best_line = len;
-        }
-    }
-
-    int s = 0;
-
-    s += 100 * best_line;
-    s +=  60 * open_three_through(after, placed_row, placed_col0, me);
-    s +=  40 * count_our_immediate_wins(after, me);
-
-    int opp_threats_after = 0;
-    for (int col = 1; col <= COLS; ++col) {
-        if (after->heights[col - 1] >= ROWS) continue;
-        if (would_win_if_drop(after, col, opp)) {
-            opp_threats_after++;
-        }
-    }
-
-    int removed = (opp_threats_before > opp_threats_after)
-                  ? (opp_threats_before - opp_threats_after)
-                  : 0;
-    s += 25 * removed;
-
-    s += 5 * (ROWS - placed_row);
-
-    rng_init_once();
-    s += (rand() % 7) - 3;
-
-    return s;
-}
-
-/* Medium bot:
-   - win if possible
-   - best blocking move
-   - best safe move
-   - otherwise best overall (even if risky) */
-static int bot_pick_medium(const Board *b, Cell bot_player) {
-    Cell opp = (bot_player == CELL_A) ? CELL_B : CELL_A;
-
-    int opp_threats_before = 0;
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-        if (would_win_if_drop(b, col, opp)) {
-            opp_threats_before++;
-        }
-    }
-
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-        if (would_win_if_drop(b, col, bot_player)) {
-            return col;
-        }
-    }
-
-    int best_block_col   = -1;
-    int best_block_score = INT_MIN;
-
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-        if (!would_win_if_drop(b, col, opp)) continue;
-
-        Board tmp = *b;
-        int r;
-        board_drop(&tmp, col, bot_player, &r);
-
-        int sc = score_move(&tmp, r, col - 1, bot_player, opp, opp_threats_before);
-        if (sc > best_block_score) {
-            best_block_score = sc;
-            best_block_col   = col;
-        }
-    }
-
-    if (best_block_col != -1) {
-        return best_block_col;
-    }
-
-    int best_col   = -1;
-    int best_score = INT_MIN;
-
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-
-        Board tmp = *b;
-        int r;
-        if (!board_drop(&tmp, col, bot_player, &r)) {
-            continue;
-        }
-
-        int unsafe = 0;
-        for (int oc = 1; oc <= COLS; ++oc) {
-            if (tmp.heights[oc - 1] >= ROWS) continue;
-            if (would_win_if_drop(&tmp, oc, opp)) {
-                unsafe = 1;
+            if (why != ENGINE_DONE) {
+                bot_search_stop(s);
                 break;
             }
         }
-        if (unsafe) continue;
 
-        int sc = score_move(&tmp, r, col - 1, bot_player, opp, opp_threats_before);
-        if (sc > best_score) {
-            best_score = sc;
-            best_col   = col;
+        unsigned updates = atomic_load(&s->progress.updates);
+        if (live && label && updates != seen) {
+            seen = updates;
+            show_progress(s, label);
+            shown = true;
         }
     }
 
-    if (best_col != -1) {
-        return best_col;
+    bot_search_wait(s);
+    if (shown) {
+        printf("\n");
     }
+    return why;
+}
 
-    best_col   = -1;
-    best_score = INT_MIN;
-
-    for (int col = 1; col <= COLS; ++col) {
-        if (b->heights[col - 1] >= ROWS) continue;
-
-        Board tmp = *b;
-        int r;
-        board_drop(&tmp, col, bot_player, &r);
-        int sc = score_move(&tmp, r, col - 1, bot_player, opp, opp_threats_before);
-
-        if (sc > best_score) {
-            best_score = sc;
-            best_col   = col;
-        }
+/* Run fn(arg) on the engine pool and wait; inline if the pool is down. */
+static void run_engine_task(void (*fn)(void*), void *arg) {
+    ThreadPool *pool = pool_default();
+    if (!pool) {
+        fn(arg);
+        return;
     }
-
-    return best_col;
+    PoolTask task;
+    pool_submit(pool, &task, fn, arg);
+    pool_wait(pool, &task);
 }
 
-/* ------------------------------------------------------------------------- */
-/* Evaluation and minimax (for the hard bot and analysis)                    */
-/* ------------------------------------------------------------------------- */
+/* One column's result for the hint ranking, e.g. "wins in 7". */
+static void format_column_result(const ColumnRanking *r, int col, char *buf, size_t n) {
+    int score = r->col_score[col - 1];
+    int plies = r->col_plies[col - 1];
 
-/* Score a window of 4 cells from the view of 'me'. */
-static int eval_window(Cell c1, Cell c2, Cell c3, Cell c4, Cell me) {
-    Cell opp = (me == CELL_A) ? CELL_B : CELL_A;
-    Cell cells[4] = { c1, c2, c3, c4 };
-
-    int me_count    = 0;
-    int opp_count   = 0;
-    int empty_count = 0;
-
-    for (int i = 0; i < 4; i++) {
-        if (cells[i] == me) {
-            me_count++;
-        } else if (cells[i] == opp) {
-            opp_count++;
-        } else if (cells[i] == CELL_EMPTY) {
-            empty_count++;
-        }
-    }
+    bool settled = r->exact || plies > 0;
 
-    if (me_count > 0 && opp_count > 0) {
-        return 0;
+    if (settled && score > 0) {
+        snprintf(buf, n, "wins in %d", plies);
+    } else if (settled && score < 0) {
+        snprintf(buf, n, "loses in %d", plies);
+    } else if (r->exact) {
+        snprintf(buf, n, "draws");
+    } else {
+        snprintf(buf, n, "%+d", score);
     }
-
-    int score = 0;
-
-    if (me_count == 3 && empty_count == 1)      score += 100;
-    else if (me_count == 2 && empty_count == 2) score += 10;
-    else if (me_count == 1 && empty_count == 3) score += 1;
-
-    if (opp_count == 3 && empty_count == 1)      score -= 120;
-    else if (opp_count == 2 && empty_count == 2) score -= 8;
-    else if (opp_count == 1 && empty_count == 3) score -= 1;
-
-    return score;
 }
 
-/* Heuristic board score from the view of 'me'. */
-static int evaluate_board(const Board *b, Cell me) {
-    Cell opp = (me == CELL_A) ? CELL_B : CELL_A;
-    int score = 0;
+/* Rank every column for 'player' on the engine pool and print them,
+   best first: solved results from the book or solver, else multi-PV
+   search scores. Rankings are cached, so asking again is instant.
+   The user or the peer may cut it short (see await_engine). */
+static EngineWait show_hint(const Board *b, Cell player, int peer_fd) {
+    BotSearch hint;
+    bot_hint_start(&hint, b, player);
 
-    int center_col = COLS / 2;
-    for (int r = 0; r < ROWS; r++) {
-        if (b->grid[r][center_col] == me) score += 6;
-        else if (b->grid[r][center_col] == opp) score -= 6;
+    EngineWait why = await_engine(&hint, "Hint", peer_fd);
+    if (why != ENGINE_DONE) {
+        return why;
     }
 
-    for (int r = 0; r < ROWS; r++) {
-        for (int c = 0; c <= COLS - 4; c++) {
-            score += eval_window(b->grid[r][c],
-                                 b->grid[r][c+1],
-                                 b->grid[r][c+2],
-                                 b->grid[r][c+3],
-                                 me);
-        }
+    const ColumnRanking *r = &hint.ranking;
+    if (r->best_col < 1) {
+        puts("No hint available.");
+        return why;
     }
 
-    for (int c = 0; c < COLS; c++) {
-        for (int r = 0; r <= ROWS - 4; r++) {
-            score += eval_window(b->grid[r][c],
-                                 b->grid[r+1][c],
-                                 b->grid[r+2][c],
-                                 b->grid[r+3][c],
-                                 me);
+    int order[COLS];
+    int n = 0;
+    for (int col = 1; col <= COLS; col++) {
+        if (r->col_score[col - 1] == BOT_NO_SCORE) continue;
+        int j = n++;
+        while (j > 0 && r->col_score[order[j - 1] - 1] < r->col_score[col - 1]) {
+            order[j] = order[j - 1];
+            j--;
         }
+        order[j] = col;
     }
 
-    for (int r = 0; r <= ROWS - 4; r++) {
-        for (int c = 0; c <= COLS - 4; c++) {
-            score += eval_window(b->grid[r][c],
-                                 b->grid[r+1][c+1],
-                                 b->grid[r+2][c+2],
-                                 b->grid[r+3][c+3],
-                                 me);
-        }
-    }
+    char what[32];
+    format_column_result(r, r->best_col, what, sizeof(what));
+    printf("Hint for player %c: column %d (%s).\n", (char)player, r->best_col, what);
 
-    for (int r = 3; r < ROWS; r++) {
-        for (int c = 0; c <= COLS - 4; c++) {
-            score += eval_window(b->grid[r][c],
-                                 b->grid[r-1][c+1],
-                                 b->grid[r-2][c+2],
-                                 b->grid[r-3][c+3],
-                                 me);
-        }
+    printf("  ");
+    for (int i = 0; i < n; i++) {
+        format_column_result(r, order[i], what, sizeof(what));
+        printf("%s%d: %s", (i > 0) ? ", " : "", order[i], what);
     }
-
-    return score;
-}
-
-/* Depth-limited minimax with alpha-beta pruning. */
-static int minimax_ab(const Board *b, int depth, int alpha, int beta,
-                      Cell bot, Cell current, int last_row, int last_col) {
-    Cell opp = (bot == CELL_A) ? CELL_B : CELL_A;
-
-    if (last_row >= 0 && last_col >= 0) {
-        Cell last_player = (current == CELL_A) ? CELL_B : CELL_A;
-        if (board_is_winning(b, last_row, last_col, last_player)) {
-            int base = 1000000;
-            if (last_player == bot) {
-                return base + depth;
-            } else {
-                return -base - depth;
-            }
-        }
+    if (r->exact) {
+        printf("  (solved%s)\n", r->cached ? ", cached" : "");
+    } else {
+        printf("  (depth %d%s)\n", r->depth, r->cached ? ", cached" : "");
     }
+    return why;
+}
 
-    if (depth == 0 || board_is_full(b)) {
-        return evaluate_board(b, bot);
+/* Say how much of the next search the ponder on the opponent's turn
+   did in advance. */
+static void print_ponder_report(const PonderReport *r, const char *prefix) {
+    if (!r->ran || r->played_col < 1) {
+        return;
     }
 
-    static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
-    int best;
-
-    if (current == bot) {
-        best = INT_MIN;
-
-        for (int i = 0; i < COLS; i++) {
-            int col = ORDER[i];
-            if (b->heights[col - 1] >= ROWS) continue;
-
-            Board tmp = *b;
-            int r;
-            if (!board_drop(&tmp, col, current, &r)) continue;
-
-            int val = minimax_ab(&tmp, depth - 1, alpha, beta,
-                                 bot,
-                                 opp,
-                                 r, col - 1);
-
-            if (val > best)  best  = val;
-            if (val > alpha) alpha = val;
-            if (beta <= alpha) break;
+    if (r->diff == BOT_MCTS) {
+        MctsResult mr;
+        if (mcts_last_result(&mr)) {
+            printf("%sPondered %.1f s (%llu playouts); the search started "
+                   "from %llu playouts already in the tree.\n",
+                   prefix, r->elapsed_ms / 1000.0, (unsigned long long)r->work,
+                   (unsigned long long)mr.reused);
         }
-
-        return best;
+    } else if (r->hit_solved) {
+        printf("%sPondered %.1f s (%llu nodes); the answer to column %d "
+               "was already solved.\n",
+               prefix, r->elapsed_ms / 1000.0, (unsigned long long)r->work,
+               r->played_col);
+    } else if (r->hit_depth > 0) {
+        printf("%sPondered %.1f s (%llu nodes); the answer to column %d "
+               "was already searched %d plies deep.\n",
+               prefix, r->elapsed_ms / 1000.0, (unsigned long long)r->work,
+               r->played_col, r->hit_depth);
     } else {
-        best = INT_MAX;
-
-        for (int i = 0; i < COLS; i++) {
-            int col = ORDER[i];
-            if (b->heights[col - 1] >= ROWS) continue;
-
-            Board tmp = *b;
-            int r;
-            if (!board_drop(&tmp, col, current, &r)) continue;
-
-            int val = minimax_ab(&tmp, depth - 1, alpha, beta,
-                                 bot,
-                                 bot,
-                                 r, col - 1);
-
-            if (val < best) best = val;
-            if (val < beta) beta = val;
-            if (beta <= alpha) break;
-        }
-
-        return best;
+        printf("%sPondered %.1f s (%llu nodes); column %d was not reached.\n",
+               prefix, r->elapsed_ms / 1000.0, (unsigned long long)r->work,
+               r->played_col);
     }
 }
 
-/* ------------------------------------------------------------------------- */
-/* Hard bot: parallel minimax over moves                                    */
-/* ------------------------------------------------------------------------- */
-
-typedef struct {
-    Board board;
-    Cell  bot;
-    Cell  opp;
-    int   col;
-    int   depth;
-    int   score;
-    int   valid;
-} HardSearchTask;
-
-static void* hard_worker_main(void *arg) {
-    HardSearchTask *t = (HardSearchTask*)arg;
-
-    if (!t->valid) {
-        t->score = INT_MIN;
-        return NULL;
-    }
+/* Per-move search statistics, chosen by CONNECT4_STATS: "json" writes
+   one JSON object per bot move to stderr, any other value except "0"
+   a summary to stdout. */
+typedef enum { STATS_OFF, STATS_TEXT, STATS_JSON } StatsMode;
 
-    int r;
-    if (!board_drop(&t->board, t->col, t->bot, &r)) {
-        t->score = INT_MIN;
-        return NULL;
+static StatsMode stats_mode(void) {
+    static int mode = -1;
+    if (mode < 0) {
+        const char *env = getenv("CONNECT4_STATS");
+        mode = (!env || !*env || strcmp(env, "0") == 0) ? STATS_OFF
+             : (strcmp(env, "json") == 0)               ? STATS_JSON
+             :                                            STATS_TEXT;
     }
-
-    t->score = minimax_ab(&t->board,
-                          t->depth - 1,
-                          INT_MIN, INT_MAX,
-                          t->bot,
-                          t->opp,
-                          r, t->col - 1);
-
-    return NULL;
+    return (StatsMode)mode;
 }
 
-/* Hard-level bot: minimax with alpha-beta and per-column threads. */
-static int bot_pick_hard(const Board *b, Cell bot_player) {
-    Cell opp = (bot_player == CELL_A) ? CELL_B : CELL_A;
-
-    int win_col = find_self_win_in_1(b, bot_player);
-    if (win_col != -1) {
-        return win_col;
-    }
-
-    int danger[COLS];
-    int dn = opponent_winning_cols(b, opp, danger);
-    if (dn > 0) {
-        return danger[0];
-    }
-
-    const int MAX_DEPTH = 7;
-    static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
-
-    HardSearchTask tasks[COLS];
-    pthread_t       threads[COLS];
-    int             has_thread[COLS];
-
-    for (int i = 0; i < COLS; i++) {
-        tasks[i].valid = 0;
-        has_thread[i]  = 0;
-    }
-
-    for (int i = 0; i < COLS; i++) {
-        int col = ORDER[i];
-        if (b->heights[col - 1] >= ROWS) {
-            continue;
-        }
-
-        tasks[i].board = *b;
-        tasks[i].bot   = bot_player;
-        tasks[i].opp   = opp;
-        tasks[i].col   = col;
-        tasks[i].depth = MAX_DEPTH;
-        tasks[i].score = INT_MIN;
-        tasks[i].valid = 1;
-
-        if (pthread_create(&threads[i], NULL, hard_worker_main, &tasks[i]) == 0) {
-            has_thread[i] = 1;
-        } else {
-            hard_worker_main(&tasks[i]);
-            has_thread[i] = 0;
-        }
-    }
-
-    int best_col   = -1;
-    int best_score = INT_MIN;
-
-    for (int i = 0; i < COLS; i++) {
-        if (!tasks[i].valid) continue;
-
-        if (has_thread[i]) {
-            pthread_join(threads[i], NULL);
-        }
-
-        int col   = tasks[i].col;
-        int score = tasks[i].score;
+static double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
 
-        if (best_col == -1 || score > best_score) {
-            best_score = score;
-            best_col   = col;
-        }
+static void print_u64_array(FILE *f, const uint64_t *v, int n) {
+    fputc('[', f);
+    for (int i = 0; i < n; i++) {
+        fprintf(f, "%s%llu", i ? "," : "", (unsigned long long)v[i]);
     }
-
-    return best_col;
+    fputc(']', f);
 }
 
-/* ------------------------------------------------------------------------- */
-/* Bot dispatch + worker thread                                              */
-/* ------------------------------------------------------------------------- */
+/* Report the search behind the bot's move 'col' at ply 'ply'. */
+static void print_search_stats(const BotSearch *s, int ply, int col) {
+    const SearchStats *st  = &s->stats;
+    double             nps = (st->elapsed_ms > 0) ? st->nodes / st->elapsed_ms * 1000.0 : 0.0;
 
-static int bot_pick_dispatch(const Board *b, BotDifficulty d, Cell bot_player) {
-    switch (d) {
-        case BOT_EASY:
-            return bot_pick_easy_plus(b, bot_player);
-        case BOT_MEDIUM:
-            return bot_pick_medium(b, bot_player);
-        case BOT_HARD:
-            return bot_pick_hard(b, bot_player);
-        default:
-            return bot_pick_easy_plus(b, bot_player);
-    }
-}
+    switch (stats_mode()) {
+        case STATS_OFF:
+            return;
 
-typedef struct {
-    Board         snapshot;
-    BotDifficulty diff;
-    Cell          bot_player;
-    int           result_col;
-} BotTask;
-
-static void* bot_thread_main(void *arg) {
-    BotTask *t = (BotTask*)arg;
-    t->result_col = bot_pick_dispatch(&t->snapshot, t->diff, t->bot_player);
-    return NULL;
+        case STATS_TEXT:
+            if (st->nodes == 0) {
+                puts("Stats: no search (book, forced move or rule-based level)");
+                return;
+            }
+            printf("Stats: depth %d (sel %d), %llu nodes (%.1f%% quiescence, %llu evals) "
+                   "in %.1f ms, %.2f Mnodes/s\n",
+                   st->depth, st->seldepth, (unsigned long long)st->nodes,
+                   percent(st->quiesce_nodes, st->nodes), (unsigned long long)st->evals,
+                   st->elapsed_ms, nps / 1e6);
+            printf("       %llu cutoffs (%.1f%% on the first move), table hits %.1f%% of %llu probes\n",
+                   (unsigned long long)st->cutoffs, percent(st->first_cutoffs, st->cutoffs),
+                   percent(st->tt_hits, st->tt_probes), (unsigned long long)st->tt_probes);
+            if (st->depth > 0) {
+                printf("       per column:");
+                for (int c = 0; c < COLS; c++) {
+                    if (st->root_nodes[c]) {
+                        printf(" %d=%.1f%%/%.1fms", c + 1,
+                               percent(st->root_nodes[c], st->nodes), st->root_ms[c]);
+                    }
+                }
+                printf("\n");
+            }
+            if (st->threads > 1) {
+                printf("       per thread:");
+                for (int i = 0; i < st->threads; i++) {
+                    printf(" %llu", (unsigned long long)st->thread_nodes[i]);
+                }
+                printf("\n");
+            }
+            return;
+
+        case STATS_JSON:
+            fprintf(stderr, "{\"ply\":%d,\"player\":\"%c\",\"level\":%d,\"col\":%d,"
+                    "\"depth\":%d,\"seldepth\":%d,\"nodes\":%llu,\"quiesce_nodes\":%llu,"
+                    "\"evals\":%llu,\"cutoffs\":%llu,\"first_cutoffs\":%llu,"
+                    "\"tt_probes\":%llu,\"tt_hits\":%llu,\"elapsed_ms\":%.3f,\"nps\":%.0f,"
+                    "\"threads\":%d,\"thread_nodes\":",
+                    ply, (char)s->player, (int)s->diff, col, st->depth, st->seldepth,
+                    (unsigned long long)st->nodes, (unsigned long long)st->quiesce_nodes,
+                    (unsigned long long)st->evals, (unsigned long long)st->cutoffs,
+                    (unsigned long long)st->first_cutoffs, (unsigned long long)st->tt_probes,
+                    (unsigned long long)st->tt_hits, st->elapsed_ms, nps, st->threads);
+            print_u64_array(stderr, st->thread_nodes, st->threads);
+            fprintf(stderr, ",\"root_nodes\":");
+            print_u64_array(stderr, st->root_nodes, COLS);
+            fprintf(stderr, ",\"root_ms\":[");
+            for (int c = 0; c < COLS; c++) {
+                fprintf(stderr, "%s%.3f", c ? "," : "", st->root_ms[c]);
+            }
+            fprintf(stderr, "]}\n");
+            fflush(stderr);
+            return;
+    }
 }
 
 /* ------------------------------------------------------------------------- */
@@ -739,15 +418,29 @@ typedef struct {
     int  col;
 } Move;
 
+typedef struct {
+    const Move *history;
+    int         move_count;
+    Cell        winner;
+} AnalysisTask;
+
 /* Replay the game and report missed wins and final evaluation. */
-static void game_post_analysis(const Move *history, int move_count, Cell winner) {
+static void analysis_task_main(void *arg) {
+    const AnalysisTask *t = (const AnalysisTask*)arg;
+    const Move *history    = t->history;
+    int         move_count = t->move_count;
+    Cell        winner     = t->winner;
+
     printf("\n=== Post-game analysis ===\n");
     printf("Total moves played: %d\n", move_count);
 
-    Board sim;
+    Board     sim;
+    EvalState sim_eval;
     board_init(&sim);
+    eval_state_init(&sim_eval, &sim);
 
     int missed_win_count = 0;
+    int ply_eval[ROWS * COLS];
 
     for (int i = 0; i < move_count; ++i) {
         Cell p  = history[i].player;
@@ -762,37 +455,75 @@ static void game_post_analysis(const Move *history, int move_count, Cell winner)
 
         int r;
         board_drop(&sim, col, p, &r);
+        eval_state_push(&sim_eval, &sim);
+        ply_eval[i] = eval_state_score(&sim_eval, CELL_A);
     }
 
     if (missed_win_count == 0) {
         printf("No missed immediate winning moves detected.\n");
     }
 
+    // Evaluation after every ply (kept up to date by sim_eval, so free to collect).
+    if (move_count > 0) {
+        printf("Evaluation by ply (A's view):");
+        for (int i = 0; i < move_count; ++i) {
+            if (i % 10 == 0) printf("\n ");
+            printf(" %+5d", ply_eval[i]);
+        }
+        printf("\n");
+    }
+
     if (winner == CELL_A || winner == CELL_B) {
-        int final_eval = evaluate_board(&sim, winner);
+        int final_eval = eval_state_score(&sim_eval, winner);
         printf("Final evaluation from winner's perspective: %+d (higher = more dominant).\n",
                final_eval);
     } else {
-        int evalA = evaluate_board(&sim, CELL_A);
-        int evalB = evaluate_board(&sim, CELL_B);
+        int evalA = eval_state_score(&sim_eval, CELL_A);
+        int evalB = eval_state_score(&sim_eval, CELL_B);
         printf("Final evaluation: A: %+d, B: %+d.\n", evalA, evalB);
     }
 
+    TTStats st;
+    size_t  tt_kb;
+    if (search_tt_stats(&st, &tt_kb)) {
+        printf("Transposition table: %zu KB, %llu hits, %llu misses, %llu collisions.\n",
+               tt_kb,
+               (unsigned long long)st.hits,
+               (unsigned long long)st.misses,
+               (unsigned long long)st.collisions);
+    }
+
+    MctsResult mr;
+    if (mcts_last_result(&mr)) {
+        printf("MCTS tree: %zu nodes (%zu of %zu KB), last move %llu playouts "
+               "(%.0f/s), %llu reused.\n",
+               mr.nodes, mr.memory_bytes / 1024, mr.arena_bytes / 1024,
+               (unsigned long long)mr.playouts, mr.playouts_per_sec,
+               (unsigned long long)mr.reused);
+    }
+
     printf("=== End of analysis ===\n");
 }
 
+static void game_post_analysis(const Move *history, int move_count, Cell winner) {
+    AnalysisTask task = { history, move_count, winner };
+    run_engine_task(analysis_task_main, &task);
+}
+
 /* ------------------------------------------------------------------------- */
 /* Networking helpers (line-based TCP protocol)                              */
 /* ------------------------------------------------------------------------- */
 
 static int send_all(int sockfd, const char *buf, size_t len) {
     size_t sent = 0;
+    TRACE_BEGIN_ARG("send", len);
     while (sent < len) {
         ssize_t n = send(sockfd, buf + sent, len - sent, 0);
-        if (n <= 0) return -1;
+        if (n <= 0) break;
         sent += (size_t)n;
     }
-    return 0;
+    TRACE_END("send");
+    return (sent == len) ? 0 : -1;
 }
 
 static int send_line(int sockfd, const char *line) {
@@ -949,6 +680,17 @@ static Cell game_run_online_server(int port) {
                 return CELL_EMPTY;
             }
 
+            if (col == -1) {
+                EngineWait why = show_hint(&b, local, conn_fd);
+                if (why != ENGINE_DONE) {
+                    puts(why == ENGINE_QUIT ? "[ONLINE] You quit the game."
+                                            : "[ONLINE] Connection closed by client.");
+                    close(conn_fd);
+                    return CELL_EMPTY;
+                }
+                continue;
+            }
+
             if (col < 1 || col > COLS) {
                 puts("[ONLINE] Invalid column, try again.");
                 continue;
@@ -996,15 +738,22 @@ static Cell game_run_online_server(int port) {
         } else {
             puts("[ONLINE] Waiting for Player B (remote) move...");
 
+            // Warm the solver (or, beyond its budget, the search) for our
+            // hints while the remote player thinks.
+            ponder_start(&b, remote, local, BOT_PERFECT);
+
             char buf[64];
             int  rcv = recv_line(conn_fd, buf, sizeof(buf));
+            int  col = -1;
+
+            PonderReport ponder;
+            ponder_stop((rcv > 0 && sscanf(buf, "MOVE %d", &col) == 1) ? col : -1, &ponder);
             if (rcv <= 0) {
                 puts("[ONLINE] Connection closed by client.");
                 close(conn_fd);
                 return CELL_EMPTY;
             }
 
-            int col = -1;
             if (sscanf(buf, "MOVE %d", &col) != 1 || col < 1 || col > COLS) {
                 printf("[ONLINE] Protocol error: got '%s'\n", buf);
                 close(conn_fd);
@@ -1023,6 +772,7 @@ static Cell game_run_online_server(int port) {
                 history[move_count].col    = col;
                 move_count++;
             }
+            print_ponder_report(&ponder, "[ONLINE] ");
 
             if (board_is_winning(&b, placed_row, col - 1, remote)) {
                 printf("\n[ONLINE] Final board:\n");
@@ -1075,15 +825,22 @@ static Cell game_run_online_client(const char *host, int port) {
         if (turn == remote) {
             puts("[ONLINE] Waiting for Player A (remote) move...");
 
+            // Warm the solver (or, beyond its budget, the search) for our
+            // hints while the remote player thinks.
+            ponder_start(&b, remote, local, BOT_PERFECT);
+
             char buf[64];
             int  rcv = recv_line(sockfd, buf, sizeof(buf));
+            int  col = -1;
+
+            PonderReport ponder;
+            ponder_stop((rcv > 0 && sscanf(buf, "MOVE %d", &col) == 1) ? col : -1, &ponder);
             if (rcv <= 0) {
                 puts("[ONLINE] Connection closed by server.");
                 close(sockfd);
                 return CELL_EMPTY;
             }
 
-            int col = -1;
             if (sscanf(buf, "MOVE %d", &col) != 1 || col < 1 || col > COLS) {
                 printf("[ONLINE] Protocol error: got '%s'\n", buf);
                 close(sockfd);
@@ -1102,6 +859,7 @@ static Cell game_run_online_client(const char *host, int port) {
                 history[move_count].col    = col;
                 move_count++;
             }
+            print_ponder_report(&ponder, "[ONLINE] ");
 
             if (board_is_winning(&b, placed_row, col - 1, remote)) {
                 printf("\n[ONLINE] Final board:\n");
@@ -1132,6 +890,17 @@ static Cell game_run_online_client(const char *host, int port) {
                 return CELL_EMPTY;
             }
 
+            if (col == -1) {
+                EngineWait why = show_hint(&b, local, sockfd);
+                if (why != ENGINE_DONE) {
+                    puts(why == ENGINE_QUIT ? "[ONLINE] You quit the game."
+                                            : "[ONLINE] Connection closed by server.");
+                    close(sockfd);
+                    return CELL_EMPTY;
+                }
+                continue;
+            }
+
             if (col < 1 || col > COLS) {
                 puts("[ONLINE] Invalid column, try again.");
                 continue;
@@ -1194,6 +963,17 @@ Cell game_run(void) {
     Board b;
     board_init(&b);
 
+    // Search results from a previous game are of no use in this one.
+    search_new_game();
+    solver_new_game();
+    mcts_new_game();
+
+    const OpeningBook *book = book_default();
+    if (book) {
+        printf("Opening book: %zu positions (up to ply %d).\n",
+               book->count, book->max_ply);
+    }
+
     Cell        turn = CELL_A;
     GameMode    mode = MODE_PVP;
     BotDifficulty diff = BOT_EASY;
@@ -1227,6 +1007,8 @@ Cell game_run(void) {
                 printf("  1) Easy\n");
                 printf("  2) Medium\n");
                 printf("  3) Hard\n");
+                printf("  4) Perfect\n");
+                printf("  5) Monte Carlo\n");
                 printf("Choice: ");
                 fflush(stdout);
 
@@ -1238,10 +1020,12 @@ Cell game_run(void) {
                 }
                 int ch; while ((ch = getchar()) != '\n' && ch != EOF) {}
 
-                if (choice == 1) { diff = BOT_EASY;   break; }
-                if (choice == 2) { diff = BOT_MEDIUM; break; }
-                if (choice == 3) { diff = BOT_HARD;   break; }
-                puts("Please choose 1, 2, or 3.");
+                if (choice == 1) { diff = BOT_EASY;    break; }
+                if (choice == 2) { diff = BOT_MEDIUM;  break; }
+                if (choice == 3) { diff = BOT_HARD;    break; }
+                if (choice == 4) { diff = BOT_PERFECT; break; }
+                if (choice == 5) { diff = BOT_MCTS;    break; }
+                puts("Please choose 1, 2, 3, 4, or 5.");
             }
         }
 
@@ -1291,6 +1075,8 @@ Cell game_run(void) {
         }
     }
 
+    PonderReport ponder = { .ran = false };
+
     while (1) {
         printf("\nCurrent board:\n");
         board_print(&b);
@@ -1301,20 +1087,23 @@ Cell game_run(void) {
         if (mode == MODE_PVP ||
     (mode == MODE_PVB && turn == CELL_A)) {
     // HUMAN turn (A in PvB, or A/B in PvP)
+    // In PvB the bot ponders its answers while the human thinks.
+    if (mode == MODE_PVB) {
+        ponder_start(&b, turn, CELL_B, diff);
+    }
+
     printf("Player %c, ", (char)turn);
-    if (!read_column_or_quit(&col)) {
+    int got = read_column_or_quit(&col);
+    ponder_stop(col, &ponder);
+    if (!got) {
         // user quit / EOF
         return CELL_EMPTY;
     }
 
     if (col == -1) {
-        // Hint request: use Hard bot logic as an advisor
-        int suggestion = bot_pick_hard(&b, turn);
-        if (suggestion < 1) {
-            puts("No hint available.");
-        } else {
-            printf("Hint for player %c: consider column %d.\n",
-                   (char)turn, suggestion);
+        if (show_hint(&b, turn, -1) == ENGINE_QUIT) {
+            puts("Quitting.");
+            return CELL_EMPTY;
         }
         // Re-prompt same player (no move played).
         continue;
@@ -1341,17 +1130,13 @@ Cell game_run(void) {
         }
 
         int c0 = last_col - 1;
-        if (c0 < 0 || c0 >= COLS || b.heights[c0] <= 0) {
+        if (c0 < 0 || c0 >= COLS || board_height(&b, c0) <= 0) {
             // Should not happen if board and history stay in sync
             puts("Cannot undo last move due to board state.");
             continue;
         }
 
-        int h   = b.heights[c0];    // 1..ROWS
-        int row = ROWS - h;         // row of top piece in this column
-
-        b.grid[row][c0] = CELL_EMPTY;
-        b.heights[c0]--;
+        board_undo(&b, NULL);
 
         move_count--;
         (*undo_used_ptr)++;
@@ -1367,21 +1152,15 @@ Cell game_run(void) {
     }
 
 } else {
-    // BOT turn (B when PvB) — compute in a separate thread
-    BotTask task;
-    board_clone(&task.snapshot, &b);   // read-only snapshot to avoid races
-    task.diff       = diff;
-    task.bot_player = turn;
-    task.result_col = -1;
-
-    pthread_t th;
-    if (pthread_create(&th, NULL, bot_thread_main, &task) != 0) {
-        // Fallback: single-threaded if thread creation fails
-        col = bot_pick_dispatch(&b, diff, turn);
-    } else {
-        pthread_join(th, NULL);
-        col = task.result_col;
+    // BOT turn (B when PvB) — computed on the engine pool on a
+    // snapshot, while the user can still quit with 'q'
+    BotSearch search;
+    bot_search_start(&search, &b, diff, turn);
+    if (await_engine(&search, "Bot", -1) == ENGINE_QUIT) {
+        puts("Quitting.");
+        return CELL_EMPTY;
     }
+    col = search.result_col;
 
     if (col < 1) {
         // No valid moves (should imply draw)
@@ -1395,10 +1174,10 @@ Cell game_run(void) {
         continue;
     }
 
-    // Small artificial delay so it looks like the bot is "thinking"
-    usleep(150000); // 150 ms
-
     printf("Bot (%c) chooses column %d\n", (char)turn, col);
+    print_search_stats(&search, move_count + 1, col);
+    print_ponder_report(&ponder, "");
+    ponder.ran = false;
 }
 
 
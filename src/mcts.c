@@ -0,0 +1,585 @@
+#define _XOPEN_SOURCE 700
+
+#include "mcts.h"
+#include "pool.h"
+#include "search.h"    // search_default_threads, SEARCH_MAX_THREADS
+#include "trace.h"
+#include <math.h>      // log, sqrt
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>    // getenv, atoi, malloc, free
+#include <string.h>    // memset
+#include <time.h>      // clock_gettime
+
+/*
+ * Positions are kept relative to the side to move, as in the solver:
+ * 'current' holds the mover's pieces and 'mask' all pieces. Node scores
+ * are half-points (win 2, draw 1, loss 0) for the player who made the
+ * move into the node, which is what its parent maximizes.
+ */
+
+/* UCT exploration constant. */
+#define MCTS_EXPLORATION 1.0
+
+/* A leaf gets children once it has been visited this many times;
+   until then its playouts start from the leaf itself. */
+#define MCTS_EXPAND_VISITS 4
+
+/* Playouts a thread runs between checks of the clock. */
+#define MCTS_CHECK_INTERVAL 64
+
+/* Checks between two progress publishes (about 1000 playouts). */
+#define MCTS_PROGRESS_INTERVAL 16
+
+/* 'children' of a node another thread is expanding right now. */
+#define MCTS_EXPANDING UINT32_MAX
+
+enum { MCTS_OPEN = 0, MCTS_WIN, MCTS_DRAW };
+
+typedef struct {
+    _Atomic uint32_t children;  // arena index of the first child, 0 = leaf
+    _Atomic int32_t  visits;    // counted on the way down (virtual loss)
+    _Atomic int32_t  score;     // half-points, added on the way back up
+    uint8_t          col;       // 0-based column of the move into the node
+    uint8_t          count;     // children, contiguous from 'children'
+    uint8_t          terminal;  // MCTS_WIN / MCTS_DRAW: the move into the node ended the game
+} MctsNode;
+
+typedef struct {
+    Bitboard current;
+    Bitboard mask;
+} MctsPos;
+
+/* Index 0 is unused so that 0 can mean "no children"; the root is 1. */
+#define MCTS_ROOT 1
+
+typedef struct {
+    MctsNode        *arena[2];   // live tree in arena[live], the other is scratch
+    int              live;
+    uint32_t         capacity;   // nodes per arena
+    _Atomic uint32_t top;        // next free index of arena[live]
+    atomic_bool      full;       // an allocation failed during this search
+    MctsPos          root;       // position at MCTS_ROOT, if has_tree
+    bool             has_tree;
+    MctsResult       last;
+    bool             has_last;
+} MctsState;
+
+static MctsState       g_mcts;
+static int             g_mcts_ready = 0;
+static pthread_once_t  g_mcts_once  = PTHREAD_ONCE_INIT;
+static pthread_mutex_t g_mcts_lock  = PTHREAD_MUTEX_INITIALIZER;
+
+/* Size comes from CONNECT4_MCTS_MB (both arenas), default MCTS_DEFAULT_ARENA_MB. */
+static void mcts_init(void) {
+    size_t mb = MCTS_DEFAULT_ARENA_MB;
+    const char *env = getenv("CONNECT4_MCTS_MB");
+    if (env && atoi(env) > 0) {
+        mb = (size_t)atoi(env);
+    }
+
+    size_t nodes = mb * 1024 * 1024 / 2 / sizeof(MctsNode);
+    if (nodes > UINT32_MAX / 2) {
+        nodes = UINT32_MAX / 2;
+    }
+    if (nodes < MCTS_ROOT + 1 + COLS) {
+        return;
+    }
+
+    g_mcts.arena[0] = malloc(nodes * sizeof(MctsNode));
+    g_mcts.arena[1] = malloc(nodes * sizeof(MctsNode));
+    if (!g_mcts.arena[0] || !g_mcts.arena[1]) {
+        free(g_mcts.arena[0]);
+        free(g_mcts.arena[1]);
+        g_mcts.arena[0] = g_mcts.arena[1] = NULL;
+        return;
+    }
+    g_mcts.capacity = (uint32_t)nodes;
+    g_mcts_ready    = 1;
+}
+
+static bool mcts_ready(void) {
+    pthread_once(&g_mcts_once, mcts_init);
+    return g_mcts_ready;
+}
+
+void mcts_new_game(void) {
+    pthread_mutex_lock(&g_mcts_lock);
+    g_mcts.has_tree = false;
+    g_mcts.has_last = false;
+    pthread_mutex_unlock(&g_mcts_lock);
+}
+
+bool mcts_last_result(MctsResult *out) {
+    pthread_mutex_lock(&g_mcts_lock);
+    bool ok = g_mcts.has_last;
+    if (ok) {
+        *out = g_mcts.last;
+    }
+    pthread_mutex_unlock(&g_mcts_lock);
+    return ok;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Positions and playouts                                                    */
+/* ------------------------------------------------------------------------- */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static MctsPos pos_play(MctsPos p, Bitboard move) {
+    MctsPos q;
+    q.current = p.current ^ p.mask;
+    q.mask    = p.mask | move;
+    return q;
+}
+
+static bool pos_equal(MctsPos a, MctsPos b) {
+    return a.current == b.current && a.mask == b.mask;
+}
+
+/* xorshift64*: one generator per thread, so playouts never share state. */
+static uint64_t rng_next(uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1DULL;
+}
+
+/* A random set bit of the non-empty 'cells'. */
+static Bitboard pick_cell(Bitboard cells, uint64_t *rng) {
+    int k = (int)(rng_next(rng) % (uint64_t)__builtin_popcountll(cells));
+    while (k-- > 0) {
+        cells &= cells - 1;
+    }
+    return cells & -cells;
+}
+
+/*
+ * Random playout from p with light tactics: the mover takes an
+ * immediate win, otherwise blocks the opponent's, otherwise avoids
+ * playing under an opponent's winning cell when it can. Returns the
+ * result in half-points for the player who moved into p.
+ */
+static int playout(MctsPos p, uint64_t *rng) {
+    for (int ply = 0; ; ply++) {
+        if (p.mask == BOARD_FULL_MASK) {
+            return 1;
+        }
+
+        Bitboard playable = board_playable(p.mask);
+        if (board_winning_cells(p.current, p.mask) & playable) {
+            return (ply & 1) ? 2 : 0;   // even ply: the opponent of that player is to move
+        }
+
+        Bitboard opp_win = board_winning_cells(p.current ^ p.mask, p.mask);
+        Bitboard forced  = opp_win & playable;
+        Bitboard move;
+
+        if (forced) {
+            move = forced & -forced;
+        } else {
+            Bitboard quiet = playable & ~(opp_win >> 1);
+            move = pick_cell(quiet ? quiet : playable, rng);
+        }
+        p = pos_play(p, move);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Tree                                                                      */
+/* ------------------------------------------------------------------------- */
+
+static void node_init(MctsNode *n, int col, int terminal) {
+    atomic_init(&n->children, 0);
+    atomic_init(&n->visits, 0);
+    atomic_init(&n->score, 0);
+    n->col      = (uint8_t)col;
+    n->count    = 0;
+    n->terminal = (uint8_t)terminal;
+}
+
+/*
+ * Give 'n' (at position p) one child per legal move. Only the thread
+ * that claimed the node calls this; the children are published with
+ * a release store. Returns false if the arena is full.
+ */
+static bool expand(MctsNode *arena, MctsNode *n, MctsPos p) {
+    Bitboard playable = board_playable(p.mask);
+    Bitboard wins     = board_winning_cells(p.current, p.mask);
+    int      count    = __builtin_popcountll(playable);
+
+    uint32_t first = atomic_fetch_add_explicit(&g_mcts.top, (uint32_t)count,
+                                               memory_order_relaxed);
+    if ((uint64_t)first + (uint64_t)count > g_mcts.capacity) {
+        atomic_store_explicit(&g_mcts.full, true, memory_order_relaxed);
+        atomic_store_explicit(&n->children, 0, memory_order_release);
+        return false;
+    }
+
+    MctsNode *child = &arena[first];
+    for (int c = 0; c < COLS; c++) {
+        Bitboard move = playable & board_column_mask(c);
+        if (!move) continue;
+
+        int terminal = (wins & move)                        ? MCTS_WIN
+                     : ((p.mask | move) == BOARD_FULL_MASK) ? MCTS_DRAW
+                     : MCTS_OPEN;
+        node_init(child++, c, terminal);
+    }
+
+    n->count = (uint8_t)count;
+    atomic_store_explicit(&n->children, first, memory_order_release);
+    return true;
+}
+
+/* UCT: the child with the best mean result plus exploration bonus;
+   children nobody has visited yet come first. */
+static MctsNode *select_child(MctsNode *arena, MctsNode *n, uint32_t first) {
+    int32_t   parent_visits = atomic_load_explicit(&n->visits, memory_order_relaxed);
+    double    log_n         = log((double)(parent_visits > 1 ? parent_visits : 1));
+    MctsNode *best          = NULL;
+    double    best_value    = -1.0;
+
+    for (int i = 0; i < n->count; i++) {
+        MctsNode *c = &arena[first + (uint32_t)i];
+        int32_t   v = atomic_load_explicit(&c->visits, memory_order_relaxed);
+        if (v == 0) {
+            return c;
+        }
+
+        int32_t s     = atomic_load_explicit(&c->score, memory_order_relaxed);
+        double  value = (double)s / (2.0 * v) + MCTS_EXPLORATION * sqrt(log_n / v);
+        if (value > best_value) {
+            best_value = value;
+            best       = c;
+        }
+    }
+    return best;
+}
+
+/*
+ * One iteration: descend from the root by UCT, counting a visit on
+ * every node passed (the virtual loss other threads see), expand the
+ * leaf, settle it by a playout and add the result back up the path.
+ */
+static void mcts_iterate(MctsNode *arena, MctsPos root, uint64_t *rng) {
+    MctsNode *path[ROWS * COLS + 1];
+    int       depth = 0;
+    MctsNode *n     = &arena[MCTS_ROOT];
+    MctsPos   p     = root;
+    int       result;
+
+    atomic_fetch_add_explicit(&n->visits, 1, memory_order_relaxed);
+    path[depth++] = n;
+
+    for (;;) {
+        if (n->terminal != MCTS_OPEN) {
+            result = (n->terminal == MCTS_WIN) ? 2 : 1;
+            break;
+        }
+
+        uint32_t first = atomic_load_explicit(&n->children, memory_order_acquire);
+        if (first == 0) {
+            uint32_t expected = 0;
+            if (atomic_load_explicit(&n->visits, memory_order_relaxed) < MCTS_EXPAND_VISITS ||
+                atomic_load_explicit(&g_mcts.full, memory_order_relaxed) ||
+                !atomic_compare_exchange_strong(&n->children, &expected, MCTS_EXPANDING) ||
+                !expand(arena, n, p)) {
+                result = playout(p, rng);
+                break;
+            }
+            first = atomic_load_explicit(&n->children, memory_order_acquire);
+        } else if (first == MCTS_EXPANDING) {
+            result = playout(p, rng);
+            break;
+        }
+
+        n = select_child(arena, n, first);
+        atomic_fetch_add_explicit(&n->visits, 1, memory_order_relaxed);
+        p = pos_play(p, board_playable(p.mask) & board_column_mask(n->col));
+        path[depth++] = n;
+    }
+
+    /* 'result' is for the player who moved into path[depth-1]. */
+    while (depth-- > 0) {
+        atomic_fetch_add_explicit(&path[depth]->score, result, memory_order_relaxed);
+        result = 2 - result;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Tree reuse                                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Index of the node at position 'target' within two plies of the root,
+   or 0 if it is not in the tree. */
+static uint32_t find_reusable(MctsNode *arena, MctsPos root, MctsPos target) {
+    if (pos_equal(root, target)) {
+        return MCTS_ROOT;
+    }
+
+    MctsNode *r     = &arena[MCTS_ROOT];
+    uint32_t  first = atomic_load(&r->children);
+    for (int i = 0; first && i < r->count; i++) {
+        MctsNode *c  = &arena[first + (uint32_t)i];
+        MctsPos   cp = pos_play(root, board_playable(root.mask) & board_column_mask(c->col));
+        if (pos_equal(cp, target)) {
+            return first + (uint32_t)i;
+        }
+
+        uint32_t gfirst = atomic_load(&c->children);
+        for (int j = 0; gfirst && j < c->count; j++) {
+            MctsNode *g  = &arena[gfirst + (uint32_t)j];
+            MctsPos   gp = pos_play(cp, board_playable(cp.mask) & board_column_mask(g->col));
+            if (pos_equal(gp, target)) {
+                return gfirst + (uint32_t)j;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Copy one node; 'children' keeps the src index for compact_subtree. */
+static void node_copy(MctsNode *dst, MctsNode *src) {
+    atomic_init(&dst->children, atomic_load(&src->children));
+    atomic_init(&dst->visits, atomic_load(&src->visits));
+    atomic_init(&dst->score, atomic_load(&src->score));
+    dst->col      = src->col;
+    dst->count    = src->count;
+    dst->terminal = src->terminal;
+}
+
+/*
+ * Copy the subtree under src[from] breadth-first into dst with its root
+ * at MCTS_ROOT. dst itself is the queue: a copied node still points at
+ * its src children until it is processed, then at their copies.
+ * Returns the next free index of dst.
+ */
+static uint32_t compact_subtree(MctsNode *dst, MctsNode *src, uint32_t from) {
+    uint32_t top = MCTS_ROOT + 1;
+
+    node_copy(&dst[MCTS_ROOT], &src[from]);
+
+    for (uint32_t i = MCTS_ROOT; i < top; i++) {
+        MctsNode *d     = &dst[i];
+        uint32_t  sfrom = atomic_load(&d->children);
+        if (sfrom == 0) {
+            continue;
+        }
+
+        atomic_store(&d->children, top);
+        for (int k = 0; k < d->count; k++) {
+            node_copy(&dst[top++], &src[sfrom + (uint32_t)k]);
+        }
+    }
+    return top;
+}
+
+/* Make the arena hold the tree for 'target': the kept subtree if the
+   previous search reached it, a fresh root otherwise. Returns the
+   playouts inherited. */
+static uint64_t prepare_root(MctsPos target) {
+    MctsNode *live = g_mcts.arena[g_mcts.live];
+    uint32_t  from = g_mcts.has_tree ? find_reusable(live, g_mcts.root, target) : 0;
+    uint32_t  top;
+
+    if (from == MCTS_ROOT) {
+        top = atomic_load(&g_mcts.top);
+    } else if (from != 0) {
+        MctsNode *scratch = g_mcts.arena[!g_mcts.live];
+        top = compact_subtree(scratch, live, from);
+        g_mcts.live = !g_mcts.live;
+    } else {
+        node_init(&g_mcts.arena[g_mcts.live][MCTS_ROOT], 0, MCTS_OPEN);
+        top = MCTS_ROOT + 1;
+    }
+
+    atomic_store(&g_mcts.top, top);
+    atomic_store(&g_mcts.full, false);
+    g_mcts.root     = target;
+    g_mcts.has_tree = true;
+
+    return (uint64_t)atomic_load(&g_mcts.arena[g_mcts.live][MCTS_ROOT].visits);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Parallel search                                                           */
+/* ------------------------------------------------------------------------- */
+
+/* State shared by all threads of one mcts_best_move() call. */
+typedef struct {
+    MctsNode        *arena;
+    MctsPos          root;
+    atomic_bool      stop;
+    _Atomic uint64_t playouts;
+    uint64_t         max_playouts;  // 0 = no playout budget
+    double           deadline_ms;   // 0 = no time budget
+    atomic_bool     *cancel;        // external stop request, or NULL
+    SearchProgress  *progress;      // published by worker 0, or NULL
+} MctsShared;
+
+typedef struct {
+    MctsShared *shared;
+    uint64_t    rng;
+    bool        reports;   // publishes progress
+    PoolTask    task;
+} MctsWorker;
+
+/* Most visited root child: its column (1..COLS) and win rate.
+   Returns false if the root has no children yet. */
+static bool root_best(MctsNode *arena, int *out_col, double *out_win_rate) {
+    MctsNode *r     = &arena[MCTS_ROOT];
+    uint32_t  first = atomic_load_explicit(&r->children, memory_order_acquire);
+    int32_t   best_visits = -1;
+
+    if (first == 0 || first == MCTS_EXPANDING) {
+        return false;
+    }
+    for (int i = 0; i < r->count; i++) {
+        MctsNode *c = &arena[first + (uint32_t)i];
+        int32_t   v = atomic_load_explicit(&c->visits, memory_order_relaxed);
+        if (v > best_visits) {
+            best_visits   = v;
+            *out_col      = c->col + 1;
+            *out_win_rate = v ? (double)atomic_load_explicit(&c->score, memory_order_relaxed)
+                                / (2.0 * v)
+                              : 0.0;
+        }
+    }
+    return true;
+}
+
+static void worker_main(void *arg) {
+    MctsWorker *w  = (MctsWorker*)arg;
+    MctsShared *sh = w->shared;
+    int         since_report = 0;
+
+    TRACE_BEGIN("mcts_worker");
+    while (!atomic_load_explicit(&sh->stop, memory_order_relaxed)) {
+        for (int i = 0; i < MCTS_CHECK_INTERVAL; i++) {
+            mcts_iterate(sh->arena, sh->root, &w->rng);
+        }
+
+        uint64_t total = atomic_fetch_add_explicit(&sh->playouts, MCTS_CHECK_INTERVAL,
+                                                   memory_order_relaxed)
+                         + MCTS_CHECK_INTERVAL;
+
+        int    col;
+        double rate;
+        if (w->reports && ++since_report >= MCTS_PROGRESS_INTERVAL &&
+            root_best(sh->arena, &col, &rate)) {
+            search_progress_publish(sh->progress, col, 0, (int)(rate * 1000.0), total);
+            since_report = 0;
+        }
+
+        if ((sh->cancel && atomic_load_explicit(sh->cancel, memory_order_relaxed)) ||
+            (sh->max_playouts > 0 && total >= sh->max_playouts) ||
+            (sh->deadline_ms > 0 && now_ms() >= sh->deadline_ms)) {
+            atomic_store(&sh->stop, true);
+        }
+    }
+    TRACE_END("mcts_worker");
+}
+
+int mcts_best_move(const Board *b, Cell to_move, const MctsLimits *limits,
+                   MctsResult *out) {
+    double start = now_ms();
+
+    MctsResult res;
+    memset(&res, 0, sizeof(res));
+    res.best_col = -1;
+
+    MctsPos root;
+    root.current = b->stones[board_player_index(to_move)];
+    root.mask    = board_mask(b);
+
+    Bitboard playable = board_playable(root.mask);
+    if (!playable) {
+        if (out) *out = res;
+        return -1;
+    }
+
+    /* Without an arena, still answer: most central legal column. */
+    static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
+    for (int i = 0; i < COLS; i++) {
+        if (playable & board_column_mask(ORDER[i] - 1)) {
+            res.best_col = ORDER[i];
+            break;
+        }
+    }
+    if (!mcts_ready()) {
+        if (out) *out = res;
+        return res.best_col;
+    }
+
+    pthread_mutex_lock(&g_mcts_lock);
+
+    res.reused = prepare_root(root);
+
+    MctsShared sh;
+    sh.arena = g_mcts.arena[g_mcts.live];
+    sh.root  = root;
+    atomic_init(&sh.stop, false);
+    atomic_init(&sh.playouts, 0);
+    sh.max_playouts = limits->playouts;
+    sh.deadline_ms  = (limits->time_ms > 0) ? start + limits->time_ms : 0;
+    sh.cancel       = limits->cancel;
+    sh.progress     = limits->progress;
+    if (sh.max_playouts == 0 && sh.deadline_ms == 0 && !sh.cancel) {
+        sh.max_playouts = MCTS_DEFAULT_PLAYOUTS;
+    }
+
+    int threads = (limits->threads > 0) ? limits->threads : search_default_threads();
+    if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+
+    /* Helpers run as pool tasks on the same tree; the calling thread
+       is worker 0. */
+    ThreadPool *pool = (threads > 1) ? pool_default() : NULL;
+    MctsWorker  workers[SEARCH_MAX_THREADS];
+    uint64_t    seed = (uint64_t)(start * 1000.0) ^ root.current ^ (root.mask << 1);
+
+    for (int i = 0; i < threads && (i == 0 || pool); i++) {
+        workers[i].shared  = &sh;
+        workers[i].rng     = (seed + (uint64_t)i * 0x9E3779B97F4A7C15ULL) | 1;
+        workers[i].reports = (i == 0 && sh.progress);
+    }
+    int started = 0;
+    for (int i = 1; pool && i < threads; i++) {
+        pool_submit(pool, &workers[i].task, worker_main, &workers[i]);
+        started++;
+    }
+    worker_main(&workers[0]);
+    for (int i = 1; i <= started; i++) {
+        pool_wait(pool, &workers[i].task);
+    }
+
+    /* Most visited root child; ties go to the leftmost column. */
+    root_best(sh.arena, &res.best_col, &res.win_rate);
+
+    uint32_t top = atomic_load(&g_mcts.top);
+    if (top > g_mcts.capacity) {
+        top = g_mcts.capacity;
+    }
+    res.playouts     = atomic_load(&sh.playouts);
+    res.nodes        = top - MCTS_ROOT;
+    res.memory_bytes = (size_t)top * sizeof(MctsNode);
+    res.arena_bytes  = 2 * (size_t)g_mcts.capacity * sizeof(MctsNode);
+    res.elapsed_ms   = now_ms() - start;
+    res.playouts_per_sec = (res.elapsed_ms > 0)
+                           ? (double)res.playouts * 1000.0 / res.elapsed_ms : 0.0;
+
+    if (!limits->no_record) {
+        g_mcts.last     = res;
+        g_mcts.has_last = true;
+    }
+    pthread_mutex_unlock(&g_mcts_lock);
+
+    if (out) {
+        *out = res;
+    }
+    return res.best_col;
+}
@@ -0,0 +1,230 @@
+#define _XOPEN_SOURCE 700
+
+#include "ponder.h"
+#include "book.h"
+#include "eval.h"
+#include "mcts.h"
+#include "pool.h"
+#include "search.h"
+#include "solver.h"
+#include "trace.h"
+#include <stdatomic.h>
+#include <string.h>    // memset
+#include <time.h>      // clock_gettime
+
+typedef struct {
+    Board         board;        // opponent to move
+    Cell          to_move;
+    Cell          engine;
+    BotDifficulty diff;
+    atomic_bool   cancel;
+    uint64_t      work;
+    int           depth[COLS];  // completed depth of the answer to each reply
+    bool          solved[COLS]; // BOT_PERFECT: answer to each reply solved
+    double        start_ms;
+    PoolTask      task;
+} PonderTask;
+
+static PonderTask  g_ponder;
+static ThreadPool *g_ponder_pool = NULL;   // non-NULL while a ponder runs
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static bool ponder_cancelled(PonderTask *t) {
+    return atomic_load_explicit(&t->cancel, memory_order_relaxed);
+}
+
+/*
+ * Opponent replies worth pondering, most likely first: if the engine
+ * threatens an immediate win the opponent must block it, otherwise
+ * replies are ranked by the opponent's evaluation after them. Replies
+ * that win on the spot end the game and are left out. Returns the count.
+ */
+static int likely_replies(const Board *b, Cell to_move, Cell engine, int out[COLS]) {
+    ThreatMap tm;
+    board_threat_map(b, &tm);
+
+    Bitboard candidates = tm.now[board_player_index(engine)];
+    if (!candidates) {
+        candidates = tm.playable;
+    }
+    candidates &= ~tm.now[board_player_index(to_move)];
+
+    int   score[COLS];
+    int   n     = 0;
+    Board child = *b;
+
+    for (; candidates; candidates &= candidates - 1) {
+        int col = board_bit_column(candidates) + 1;
+        board_drop(&child, col, to_move, NULL);
+        int sc = evaluate_board(&child, to_move);
+        board_undo(&child, NULL);
+
+        int j = n++;
+        while (j > 0 && score[j - 1] < sc) {
+            out[j]   = out[j - 1];
+            score[j] = score[j - 1];
+            j--;
+        }
+        out[j]   = col;
+        score[j] = sc;
+    }
+    return n;
+}
+
+/* Alpha-beta levels: one more ply on the answer to every likely reply
+   per round, until each is searched to the end or cancelled. All of it
+   is one table generation (started by ponder_start), so the real search
+   finds the pondered entries current rather than many generations old.
+   The searches run on this task's thread alone, so the other workers
+   stay free for the engine's real move. */
+static void ponder_replies(PonderTask *t) {
+    int replies[COLS];
+    int n = likely_replies(&t->board, t->to_move, t->engine, replies);
+    bool finished[COLS] = { false };
+
+    for (int depth = 1; depth <= ROWS * COLS && !ponder_cancelled(t); depth++) {
+        int open = 0;
+
+        for (int i = 0; i < n && !ponder_cancelled(t); i++) {
+            int col = replies[i];
+            if (finished[col - 1]) continue;
+
+            Board child = t->board;
+            board_drop(&child, col, t->to_move, NULL);
+
+            SearchLimits limits = { depth, 0, 0, 1, &t->cancel, NULL, false, true };
+            SearchResult res;
+            search_best_move(&child, t->engine, &limits, &res);
+            t->work += res.stats.nodes;
+
+            if (res.depth < depth) {
+                break;   // cancelled part way
+            }
+            t->depth[col - 1] = depth;
+
+            int empty = ROWS * COLS - child.moves;
+            if (depth >= empty || res.score > WIN_SCORE / 2 || res.score < -WIN_SCORE / 2) {
+                finished[col - 1] = true;
+            } else {
+                open++;
+            }
+        }
+        if (open == 0) {
+            break;
+        }
+    }
+}
+
+/* Perfect level: solve the engine's answer to every likely reply within
+   the level's solver budget, so the real move (and hints) find the
+   results in the solver table. Book positions need no solving. Once a
+   solve runs over budget the real move will too and fall back to the
+   hard search, so the rest of the ponder warms that search instead. */
+static void ponder_solve_replies(PonderTask *t) {
+    int replies[COLS];
+    int n = likely_replies(&t->board, t->to_move, t->engine, replies);
+
+    for (int i = 0; i < n && !ponder_cancelled(t); i++) {
+        int   col = replies[i];
+        Board child = t->board;
+        int   scores[COLS];
+        board_drop(&child, col, t->to_move, NULL);
+
+        if (book_column_scores(book_default(), &child, t->engine, scores)) {
+            t->solved[col - 1] = true;
+            continue;
+        }
+
+        SolverLimits limits = *bot_solver_limits();
+        SolverResult res;
+        limits.cancel = &t->cancel;
+        bool solved = solver_solve(&child, t->engine, &limits, &res);
+        t->work += res.nodes;
+
+        if (ponder_cancelled(t)) {
+            return;
+        }
+        if (!solved) {
+            ponder_replies(t);
+            return;
+        }
+        t->solved[col - 1] = true;
+    }
+}
+
+static void ponder_main(void *arg) {
+    PonderTask *t = (PonderTask*)arg;
+
+    TRACE_BEGIN_ARG("ponder", t->diff);
+    if (t->diff == BOT_MCTS) {
+        MctsLimits limits = { 0, 0, 0, &t->cancel, NULL, true };
+        MctsResult res;
+        mcts_best_move(&t->board, t->to_move, &limits, &res);
+        t->work = res.playouts;
+    } else if (t->diff == BOT_PERFECT) {
+        ponder_solve_replies(t);
+    } else {
+        ponder_replies(t);
+    }
+    TRACE_END("ponder");
+}
+
+void ponder_start(const Board *b, Cell to_move, Cell engine, BotDifficulty d) {
+    ponder_stop(-1, NULL);
+
+    if ((d != BOT_HARD && d != BOT_PERFECT && d != BOT_MCTS) || board_is_full(b)) {
+        return;
+    }
+    ThreadPool *pool = pool_default();
+    if (!pool) {
+        return;
+    }
+
+    PonderTask *t = &g_ponder;
+    memset(t, 0, sizeof(*t));
+    t->board    = *b;
+    t->to_move  = to_move;
+    t->engine   = engine;
+    t->diff     = d;
+    t->start_ms = now_ms();
+    atomic_init(&t->cancel, false);
+
+    TranspositionTable *tt = search_tt();
+    if (tt && d != BOT_MCTS) {
+        tt_new_search(tt);
+    }
+
+    g_ponder_pool = pool;
+    pool_submit(pool, &t->task, ponder_main, t);
+}
+
+void ponder_stop(int played_col, PonderReport *out) {
+    PonderReport rep;
+    memset(&rep, 0, sizeof(rep));
+    rep.played_col = played_col;
+
+    if (g_ponder_pool) {
+        PonderTask *t = &g_ponder;
+        atomic_store(&t->cancel, true);
+        pool_wait(g_ponder_pool, &t->task);
+        g_ponder_pool = NULL;
+
+        rep.ran        = true;
+        rep.diff       = t->diff;
+        rep.elapsed_ms = now_ms() - t->start_ms;
+        rep.work       = t->work;
+        if (played_col >= 1 && played_col <= COLS) {
+            rep.hit_depth  = t->depth[played_col - 1];
+            rep.hit_solved = t->solved[played_col - 1];
+        }
+    }
+
+    if (out) {
+        *out = rep;
+    }
+}
@@ -0,0 +1,290 @@
+#define _XOPEN_SOURCE 700
+
+#include "pool.h"
+#include "trace.h"
+#include <stdio.h>     // snprintf
+#include <stdlib.h>    // getenv, atoi
+#include <string.h>    // memset
+#include <unistd.h>    // sysconf
+
+/* Index of the calling thread's deque in the pool it works for. */
+static _Thread_local ThreadPool *t_pool   = NULL;
+static _Thread_local int         t_worker = -1;
+
+/* Task running on this thread (NULL outside tasks), and a per-thread
+   address that owns what a thread outside any task submits. */
+static _Thread_local PoolTask *t_task = NULL;
+static _Thread_local char      t_self;
+
+static const void *pool_owner(void) {
+    return t_task ? (const void*)t_task : (const void*)&t_self;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Deques                                                                    */
+/* ------------------------------------------------------------------------- */
+
+static void deque_push_back(PoolDeque *d, PoolTask *t) {
+    pthread_mutex_lock(&d->lock);
+    t->next = NULL;
+    t->prev = d->tail;
+    if (d->tail) {
+        d->tail->next = t;
+    } else {
+        d->head = t;
+    }
+    d->tail = t;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static PoolTask *deque_pop_back(PoolDeque *d) {
+    pthread_mutex_lock(&d->lock);
+    PoolTask *t = d->tail;
+    if (t) {
+        d->tail = t->prev;
+        if (d->tail) {
+            d->tail->next = NULL;
+        } else {
+            d->head = NULL;
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+    return t;
+}
+
+/* Newest task owned by 'owner', unlinked from wherever it sits. */
+static PoolTask *deque_take_owned(PoolDeque *d, const void *owner) {
+    pthread_mutex_lock(&d->lock);
+    PoolTask *t = d->tail;
+    while (t && t->owner != owner) {
+        t = t->prev;
+    }
+    if (t) {
+        if (t->prev) t->prev->next = t->next; else d->head = t->next;
+        if (t->next) t->next->prev = t->prev; else d->tail = t->prev;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return t;
+}
+
+static PoolTask *deque_pop_front(PoolDeque *d) {
+    pthread_mutex_lock(&d->lock);
+    PoolTask *t = d->head;
+    if (t) {
+        d->head = t->next;
+        if (d->head) {
+            d->head->prev = NULL;
+        } else {
+            d->tail = NULL;
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+    return t;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Scheduling                                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Own deque first (newest task), then steal the oldest task elsewhere. */
+static PoolTask *pool_find_task(ThreadPool *pool, int self) {
+    PoolTask *t = NULL;
+    int       n = pool->workers + 1;
+
+    if (self >= 0) {
+        t = deque_pop_back(&pool->deques[self]);
+    }
+    for (int i = 1; !t && i <= n; i++) {
+        int victim = ((self < 0 ? pool->workers : self) + i) % n;
+        t = deque_pop_front(&pool->deques[victim]);
+    }
+
+    if (t) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+    return t;
+}
+
+static void pool_run_task(ThreadPool *pool, PoolTask *t) {
+    PoolTask *outer = t_task;
+    t_task = t;
+    TRACE_BEGIN("pool_task");
+    t->fn(t->arg);
+    TRACE_END("pool_task");
+    t_task = outer;
+    atomic_store_explicit(&t->done, true, memory_order_release);
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+typedef struct {
+    ThreadPool *pool;
+    int         id;
+} WorkerArg;
+
+static void *pool_worker_main(void *arg) {
+    ThreadPool *pool = ((WorkerArg*)arg)->pool;
+    t_pool   = pool;
+    t_worker = ((WorkerArg*)arg)->id;
+    free(arg);
+
+#ifdef CONNECT4_TRACE
+    char name[32];
+    snprintf(name, sizeof(name), "pool worker %d", t_worker);
+    TRACE_THREAD_NAME(name);
+#endif
+
+    while (!atomic_load(&pool->stop)) {
+        PoolTask *t = pool_find_task(pool, t_worker);
+        if (t) {
+            pool_run_task(pool, t);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !atomic_load(&pool->stop)) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Raise the stop flag and join the first n workers. */
+static void pool_join_workers(ThreadPool *pool, int n) {
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->stop, true);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < n; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+}
+
+static void pool_free_locks(ThreadPool *pool) {
+    for (int i = 0; i <= POOL_MAX_WORKERS; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+int pool_init(ThreadPool *pool, int workers) {
+    if (workers < 1)                workers = 1;
+    if (workers > POOL_MAX_WORKERS) workers = POOL_MAX_WORKERS;
+
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->stop, false);
+    for (int i = 0; i <= POOL_MAX_WORKERS; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    /* Workers index the injection deque as pool->workers, so the count
+       is fixed before any thread starts. */
+    pool->workers = workers;
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        WorkerArg *arg = malloc(sizeof(*arg));
+        if (!arg) break;
+        arg->pool = pool;
+        arg->id   = i;
+        if (pthread_create(&pool->threads[i], NULL, pool_worker_main, arg) != 0) {
+            free(arg);
+            break;
+        }
+        started++;
+    }
+
+    if (started < workers) {
+        /* Nothing was submitted yet: restart with the threads we can get. */
+        pool_join_workers(pool, started);
+        pool_free_locks(pool);
+        return (started == 0) ? -1 : pool_init(pool, started);
+    }
+    return 0;
+}
+
+void pool_destroy(ThreadPool *pool) {
+    pool_join_workers(pool, pool->workers);
+    pool_free_locks(pool);
+    pool->workers = 0;
+}
+
+void pool_submit(ThreadPool *pool, PoolTask *task, PoolFn fn, void *arg) {
+    TRACE_INSTANT("pool_submit", 0);
+    task->fn    = fn;
+    task->arg   = arg;
+    task->owner = pool_owner();
+    atomic_init(&task->done, false);
+
+    int d = (t_pool == pool) ? t_worker : pool->workers;
+    deque_push_back(&pool->deques[d], task);
+    atomic_fetch_add(&pool->queued, 1);
+
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_wait(ThreadPool *pool, PoolTask *task) {
+    /* Our subtasks sit on the deque we submit to, unless stolen. */
+    PoolDeque  *own   = &pool->deques[(t_pool == pool) ? t_worker : pool->workers];
+    const void *owner = pool_owner();
+
+    while (!pool_done(task)) {
+        PoolTask *t = deque_take_owned(own, owner);
+        if (t) {
+            atomic_fetch_sub(&pool->queued, 1);
+            pool_run_task(pool, t);
+            continue;
+        }
+
+        /* None left: only we could queue more, so sleep until a task
+           (ours, eventually) finishes. */
+        pthread_mutex_lock(&pool->lock);
+        if (!pool_done(task)) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+int pool_default_workers(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1)                return 1;
+    if (n > POOL_MAX_WORKERS) return POOL_MAX_WORKERS;
+    return (int)n;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Process-wide pool                                                         */
+/* ------------------------------------------------------------------------- */
+
+static ThreadPool     g_pool;
+static int            g_pool_ready = 0;
+static pthread_once_t g_pool_once  = PTHREAD_ONCE_INIT;
+
+/* Size comes from CONNECT4_THREADS, default one worker per online CPU. */
+static void pool_default_init(void) {
+    int workers = pool_default_workers();
+    const char *env = getenv("CONNECT4_THREADS");
+    if (env && atoi(env) > 0) {
+        workers = atoi(env);
+    }
+    g_pool_ready = (pool_init(&g_pool, workers) == 0);
+}
+
+ThreadPool *pool_default(void) {
+    pthread_once(&g_pool_once, pool_default_init);
+    return g_pool_ready ? &g_pool : NULL;
+}
@@ -0,0 +1,907 @@
+#define _XOPEN_SOURCE 700
+
+#include "search.h"
+#include "eval.h"
+#include "pool.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>    // getenv, atoi
+#include <string.h>    // memset
+#include <time.h>      // clock_gettime
+
+/* Nodes a thread searches between checks of the clock and node budget. */
+#define SEARCH_CHECK_INTERVAL 1024
+
+/* Move ordering keys, highest first (see order_moves). */
+#define ORDER_KEY_TT      (1 << 30)
+#define ORDER_KEY_WIN     (1 << 29)
+#define ORDER_KEY_BLOCK   (1 << 28)
+#define ORDER_KEY_KILLER  (1 << 27)
+#define ORDER_KEY_THREAT  (1 << 26)
+#define HISTORY_MAX       (1 << 25)   // history scores are halved past this
+
+/* Bound beyond every score, so -SEARCH_INF does not overflow. */
+#define SEARCH_INF  (2 * WIN_SCORE)
+
+/* Late move reductions: from this depth and move index, quiet moves
+   are first probed this many plies shallower. */
+#define SEARCH_LMR_MIN_DEPTH  3
+#define SEARCH_LMR_MIN_MOVE   3
+#define SEARCH_LMR_REDUCTION  1
+
+/* Longest run of forced moves followed past the horizon. */
+#define SEARCH_QUIESCE_MAX_PLIES 12
+
+/* Aspiration window half-width and the first depth that uses one. */
+#define SEARCH_ASPIRATION            300
+#define SEARCH_ASPIRATION_MIN_DEPTH  4
+
+static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
+
+/* ------------------------------------------------------------------------- */
+/* Shared transposition table                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Table shared by every search of the process; it survives between
+   moves so later searches start from earlier results. */
+static TranspositionTable g_tt;
+static int                g_tt_ready = 0;
+static pthread_once_t     g_tt_once  = PTHREAD_ONCE_INIT;
+
+/* Size comes from CONNECT4_TT_MB (megabytes), default TT_DEFAULT_SIZE_MB. */
+static void search_tt_init(void) {
+    size_t mb = TT_DEFAULT_SIZE_MB;
+    const char *env = getenv("CONNECT4_TT_MB");
+    if (env && atoi(env) > 0) {
+        mb = (size_t)atoi(env);
+    }
+    g_tt_ready = (tt_init(&g_tt, mb) == 0);
+}
+
+TranspositionTable *search_tt(void) {
+    pthread_once(&g_tt_once, search_tt_init);
+    return g_tt_ready ? &g_tt : NULL;
+}
+
+void search_new_game(void) {
+    if (g_tt_ready) {
+        tt_clear(&g_tt);
+    }
+}
+
+bool search_tt_stats(TTStats *out, size_t *out_kb) {
+    if (!g_tt_ready) {
+        return false;
+    }
+    tt_stats_get(&g_tt, out);
+    if (out_kb) {
+        *out_kb = g_tt.bucket_count * sizeof(TTBucket) / 1024;
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Budget tracking                                                           */
+/* ------------------------------------------------------------------------- */
+
+/* State shared by all threads of one search call. */
+typedef struct {
+    atomic_bool      stop;         // budget exhausted: unwind now
+    atomic_bool      can_stop;     // false until depth 1 has completed
+    _Atomic uint64_t nodes;        // node counts published by the threads
+    uint64_t         max_nodes;    // 0 = no node budget
+    double           deadline_ms;  // now_ms() deadline, 0 = no time budget
+    atomic_bool     *cancel;       // external stop request, or NULL
+    bool             quiesce;      // follow forced moves at the horizon
+} SearchShared;
+
+/* Per-thread search state for negamax. */
+typedef struct {
+    TranspositionTable *tt;         // shared table, or NULL to search without
+    TTStats             tt_stats;   // this thread's probe/store counters
+    SearchShared       *shared;
+    uint64_t            nodes;      // nodes visited by this thread
+    uint64_t            qnodes;     // ... of them past the horizon
+    uint64_t            unflushed;  // nodes not yet added to shared->nodes
+    uint64_t            evals;      // leaves settled by evaluate_board()
+    uint64_t            cutoffs;        // beta cutoffs
+    uint64_t            first_cutoffs;  // ... caused by the first move tried
+    int                 root_moves;     // pieces on the board at the root
+    int                 seldepth;       // deepest ply below the root reached
+    uint64_t            root_nodes[COLS];  // nodes below each root column
+    double              root_ms[COLS];     // ... and time spent there
+    int                 killers[ROWS * COLS + 1][2];  // per board ply, 1-based cols
+    uint32_t            history[2][COLS];             // per side and column
+} SearchCtx;
+
+/* Monotonic wall clock in milliseconds. */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static bool search_stopped(const SearchCtx *ctx) {
+    return atomic_load_explicit(&ctx->shared->stop, memory_order_relaxed);
+}
+
+/* Count one node. Every SEARCH_CHECK_INTERVAL nodes, publish the count
+   and check the budget. Returns true if the search must unwind. */
+static bool search_tick(SearchCtx *ctx) {
+    ctx->nodes++;
+
+    if (++ctx->unflushed >= SEARCH_CHECK_INTERVAL) {
+        SearchShared *sh = ctx->shared;
+        uint64_t total = atomic_fetch_add_explicit(&sh->nodes, ctx->unflushed,
+                                                   memory_order_relaxed)
+                         + ctx->unflushed;
+        ctx->unflushed = 0;
+
+        if (sh->cancel && atomic_load_explicit(sh->cancel, memory_order_relaxed)) {
+            atomic_store(&sh->stop, true);
+        } else if (atomic_load_explicit(&sh->can_stop, memory_order_relaxed) &&
+            ((sh->max_nodes > 0 && total >= sh->max_nodes) ||
+             (sh->deadline_ms > 0 && now_ms() >= sh->deadline_ms))) {
+            atomic_store(&sh->stop, true);
+        }
+    }
+
+    return search_stopped(ctx);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Alpha-beta search                                                         */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Position a search thread plays and undoes moves on: the board plus
+ * its Zobrist key and evaluation, updated together by pos_drop() and
+ * pos_undo() so neither is recomputed per node.
+ */
+typedef struct {
+    Board     board;
+    uint64_t  key;
+    EvalState eval;
+} SearchPos;
+
+static void pos_init(SearchPos *pos, const Board *b) {
+    pos->board = *b;
+    board_compute_keys(b, &pos->key, NULL);
+    eval_state_init(&pos->eval, b);
+}
+
+static bool pos_drop(SearchPos *pos, int col, Cell piece, int *out_row) {
+    if (!board_drop(&pos->board, col, piece, out_row)) {
+        return false;
+    }
+    pos->key ^= board_last_zobrist(&pos->board);
+    eval_state_push(&pos->eval, &pos->board);
+    return true;
+}
+
+static void pos_undo(SearchPos *pos) {
+    pos->key ^= board_last_zobrist(&pos->board);
+    eval_state_pop(&pos->eval, &pos->board);
+    board_undo(&pos->board, NULL);
+}
+
+/* Search scores depend on whose view (bot) and whose turn it is, so both
+   are folded into the position's Zobrist key with codes of their own
+   (player index 2 is not used by any piece). */
+static uint64_t search_key(const SearchPos *pos, Cell bot, Cell current) {
+    uint64_t key = pos->key;
+    if (bot == CELL_B)     key ^= board_zobrist(2, 0);
+    if (current == CELL_B) key ^= board_zobrist(2, 1);
+    return key;
+}
+
+/* Win scores count remaining depth; store them relative to the node so
+   they stay valid when the entry is reused at a different depth. */
+static int tt_score_to(int score, int depth) {
+    if (score >  WIN_SCORE / 2) return score - depth;
+    if (score < -WIN_SCORE / 2) return score + depth;
+    return score;
+}
+
+static int tt_score_from(int score, int depth) {
+    if (score >  WIN_SCORE / 2) return score + depth;
+    if (score < -WIN_SCORE / 2) return score - depth;
+    return score;
+}
+
+/*
+ * Fill moves[] with the playable columns, best candidates first:
+ *   1. the table's move
+ *   2. immediate wins for 'current'
+ *   3. blocks of the opponent's immediate wins
+ *   4. the two killer moves of this ply (most recent first)
+ *   5. moves creating new winning cells, more cells first
+ *   6. quiet moves by history score
+ * Ties keep the central ORDER. keys[] receives each move's ordering
+ * key (ORDER_KEY_*). Returns the number of moves.
+ */
+static int order_moves(const SearchCtx *ctx, const Board *b, Cell current,
+                       int tt_move, int moves[COLS], int keys[COLS]) {
+    int      me       = board_player_index(current);
+    Bitboard own      = b->stones[me];
+    Bitboard mask     = board_mask(b);
+    Bitboard playable = board_playable(mask);
+    Bitboard own_wins = board_winning_cells(own, mask);
+    Bitboard opp_wins = board_winning_cells(b->stones[me ^ 1], mask) & playable;
+    int      threats  = __builtin_popcountll(own_wins);
+    const int *killer = ctx->killers[b->moves];
+
+    int n = 0;
+
+    for (int i = 0; i < COLS; i++) {
+        int      col  = ORDER[i];
+        Bitboard move = playable & board_column_mask(col - 1);
+        if (!move) continue;
+
+        int key;
+        if (col == tt_move) {
+            key = ORDER_KEY_TT;
+        } else if (move & own_wins) {
+            key = ORDER_KEY_WIN;
+        } else if (move & opp_wins) {
+            key = ORDER_KEY_BLOCK;
+        } else if (col == killer[0]) {
+            key = ORDER_KEY_KILLER + 1;
+        } else if (col == killer[1]) {
+            key = ORDER_KEY_KILLER;
+        } else {
+            int created = __builtin_popcountll(
+                              board_winning_cells(own | move, mask | move)) - threats;
+            key = (created > 0) ? ORDER_KEY_THREAT + created
+                                : (int)ctx->history[me][col - 1];
+        }
+
+        int j = n++;
+        while (j > 0 && keys[j - 1] < key) {
+            moves[j] = moves[j - 1];
+            keys[j]  = keys[j - 1];
+            j--;
+        }
+        moves[j] = col;
+        keys[j]  = key;
+    }
+
+    return n;
+}
+
+/* Remember a move that caused a cutoff at this ply and for this side. */
+static void note_cutoff(SearchCtx *ctx, const Board *b, Cell current,
+                        int col, int depth, int move_index) {
+    ctx->cutoffs++;
+    if (move_index == 0) {
+        ctx->first_cutoffs++;
+    }
+
+    int *killer = ctx->killers[b->moves];
+    if (killer[0] != col) {
+        killer[1] = killer[0];
+        killer[0] = col;
+    }
+
+    uint32_t *h = ctx->history[board_player_index(current)];
+    h[col - 1] += (uint32_t)(depth * depth);
+    if (h[col - 1] > HISTORY_MAX) {
+        for (int c = 0; c < COLS; c++) {
+            h[c] /= 2;
+        }
+    }
+}
+
+/*
+ * Horizon quiescence: rather than evaluating a position where a side
+ * can win at once, follow the forced moves until it is quiet. The side
+ * to move wins if it can complete a four, loses if the opponent has two
+ * winning cells to play, and must block if the opponent has one; only
+ * that block is played, so each forced ply costs a single node. Scores
+ * use negamax()'s encoding with 'depth' counting down past zero. The
+ * caller has already counted this node.
+ */
+static int quiesce(SearchCtx *ctx, SearchPos *pos, int depth, Cell bot, Cell current) {
+    Board   *b        = &pos->board;
+    int      me       = board_player_index(current);
+    Bitboard mask     = board_mask(b);
+    Bitboard playable = board_playable(mask);
+
+    if (board_winning_cells(b->stones[me], mask) & playable) {
+        return WIN_SCORE + depth - 1;
+    }
+
+    Bitboard opp_now = board_winning_cells(b->stones[me ^ 1], mask) & playable;
+    if (opp_now & (opp_now - 1)) {
+        return -WIN_SCORE - depth + 2;
+    }
+    if (!opp_now || depth <= -SEARCH_QUIESCE_MAX_PLIES) {
+        ctx->evals++;
+        int v = eval_state_score(&pos->eval, bot);
+        return (current == bot) ? v : -v;
+    }
+
+    Cell opp = (current == CELL_A) ? CELL_B : CELL_A;
+    int  v   = 0;
+
+    pos_drop(pos, board_bit_column(opp_now) + 1, current, NULL);
+    ctx->qnodes++;
+    if (b->moves - ctx->root_moves > ctx->seldepth) {
+        ctx->seldepth = b->moves - ctx->root_moves;
+    }
+    if (!search_tick(ctx)) {
+        v = -quiesce(ctx, pos, depth - 1, bot, opp);
+    }
+    pos_undo(pos);
+    return v;
+}
+
+/*
+ * Depth-limited negamax with principal variation search. Scores are
+ * from the view of 'current' (the side to move); the heuristic is
+ * evaluate_board() from bot's view (read from pos->eval), negated on
+ * the opponent's turns.
+ *
+ * The first move gets the full (alpha, beta) window; later moves are
+ * probed with a null window and re-searched only if they fail high.
+ * Late quiet moves (no win, block, killer or new threat) are probed
+ * SEARCH_LMR_REDUCTION plies shallower first. At the horizon,
+ * quiesce() plays out forced moves before the position is evaluated.
+ *
+ * Children are searched by playing and undoing moves on pos in place.
+ * Results are cached in ctx->tt. When the budget runs out the search
+ * unwinds returning 0 and stores nothing; the caller discards the
+ * whole iteration.
+ */
+static int negamax(SearchCtx *ctx, SearchPos *pos, int depth, int alpha, int beta,
+                   Cell bot, Cell current, int last_row, int last_col) {
+    Board *b   = &pos->board;
+    Cell   opp = (current == CELL_A) ? CELL_B : CELL_A;
+
+    if (search_tick(ctx)) {
+        return 0;
+    }
+    if (b->moves - ctx->root_moves > ctx->seldepth) {
+        ctx->seldepth = b->moves - ctx->root_moves;
+    }
+
+    if (last_row >= 0 && last_col >= 0 &&
+        board_is_winning(b, last_row, last_col, opp)) {
+        return -WIN_SCORE - depth;
+    }
+
+    if (depth == 0 && !board_is_full(b) && ctx->shared->quiesce) {
+        return quiesce(ctx, pos, 0, bot, current);
+    }
+    if (depth == 0 || board_is_full(b)) {
+        ctx->evals++;
+        int v = eval_state_score(&pos->eval, bot);
+        return (current == bot) ? v : -v;
+    }
+
+    int      alpha0  = alpha;
+    int      tt_move = 0;
+    uint64_t key     = 0;
+
+    if (ctx->tt) {
+        TTEntry e;
+        key = search_key(pos, bot, current);
+        if (tt_probe(ctx->tt, key, &e, &ctx->tt_stats)) {
+            tt_move = e.move;
+            if (e.depth >= depth) {
+                int v = tt_score_from(e.score, depth);
+                if (e.bound == TT_BOUND_EXACT) return v;
+                if (e.bound == TT_BOUND_LOWER && v > alpha) alpha = v;
+                if (e.bound == TT_BOUND_UPPER && v < beta)  beta  = v;
+                if (beta <= alpha) return v;
+            }
+        }
+    }
+
+    int moves[COLS];
+    int keys[COLS];
+    int n = order_moves(ctx, b, current, tt_move, moves, keys);
+
+    int best     = -SEARCH_INF;
+    int best_col = 0;
+
+    for (int i = 0; i < n; i++) {
+        int col = moves[i];
+        int r;
+        if (!pos_drop(pos, col, current, &r)) continue;
+
+        int val;
+        if (i == 0) {
+            val = -negamax(ctx, pos, depth - 1, -beta, -alpha, bot, opp, r, col - 1);
+        } else {
+            int reduce = (depth >= SEARCH_LMR_MIN_DEPTH && i >= SEARCH_LMR_MIN_MOVE &&
+                          keys[i] < ORDER_KEY_THREAT) ? SEARCH_LMR_REDUCTION : 0;
+
+            val = -negamax(ctx, pos, depth - 1 - reduce, -alpha - 1, -alpha,
+                           bot, opp, r, col - 1);
+            if (reduce && val > alpha) {
+                val = -negamax(ctx, pos, depth - 1, -alpha - 1, -alpha,
+                               bot, opp, r, col - 1);
+            }
+            if (val > alpha && val < beta) {
+                val = -negamax(ctx, pos, depth - 1, -beta, -alpha, bot, opp, r, col - 1);
+            }
+        }
+        pos_undo(pos);
+
+        if (search_stopped(ctx)) {
+            return 0;
+        }
+
+        if (val > best) {
+            best     = val;
+            best_col = col;
+        }
+        if (val > alpha) {
+            alpha = val;
+        }
+        if (alpha >= beta) {
+            note_cutoff(ctx, b, current, col, depth, i);
+            break;
+        }
+    }
+
+    if (ctx->tt) {
+        TTBound bound = (best <= alpha0) ? TT_BOUND_UPPER
+                      : (best >= beta)   ? TT_BOUND_LOWER
+                      :                    TT_BOUND_EXACT;
+        tt_store(ctx->tt, key, depth, tt_score_to(best, depth), bound,
+                 best_col, &ctx->tt_stats);
+    }
+
+    return best;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Root search and Lazy SMP driver                                           */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Search the root for 'bot' to move within (alpha, beta). Root moves
+ * are tried first_col first (or the table's move when first_col is 0),
+ * then in ORDER rotated by 'rotate' so helper threads start on
+ * different subtrees, with the same PVS probes as negamax(). Returns
+ * the score; a score <= alpha or >= beta is only a bound and the
+ * caller must widen the window. *out_col receives the best column.
+ * The result is meaningless if the search was stopped.
+ */
+static int search_root(SearchCtx *ctx, SearchPos *pos, Cell bot, int depth,
+                       int alpha, int beta, int first_col, int rotate,
+                       int *out_col) {
+    Cell     opp = (bot == CELL_A) ? CELL_B : CELL_A;
+    uint64_t key = search_key(pos, bot, bot);
+
+    if (first_col == 0 && ctx->tt) {
+        TTEntry e;
+        if (tt_probe(ctx->tt, key, &e, &ctx->tt_stats)) {
+            first_col = e.move;
+        }
+    }
+
+    int moves[COLS];
+    int n = 0;
+
+    if (first_col >= 1 && first_col <= COLS) {
+        moves[n++] = first_col;
+    }
+    for (int i = 0; i < COLS; i++) {
+        int col = ORDER[(i + rotate) % COLS];
+        if (col != first_col) moves[n++] = col;
+    }
+
+    int alpha0   = alpha;
+    int best     = -SEARCH_INF;
+    int best_col = -1;
+    int searched = 0;
+
+    for (int i = 0; i < n; i++) {
+        int col = moves[i];
+        int r;
+        if (!pos_drop(pos, col, bot, &r)) continue;
+
+        uint64_t nodes0 = ctx->nodes;
+        double   t0     = now_ms();
+        TRACE_BEGIN_ARG("root_move", col);
+        int val;
+        if (searched++ == 0) {
+            val = -negamax(ctx, pos, depth - 1, -beta, -alpha, bot, opp, r, col - 1);
+        } else {
+            val = -negamax(ctx, pos, depth - 1, -alpha - 1, -alpha, bot, opp, r, col - 1);
+            if (val > alpha && val < beta) {
+                val = -negamax(ctx, pos, depth - 1, -beta, -alpha, bot, opp, r, col - 1);
+            }
+        }
+        pos_undo(pos);
+        TRACE_END("root_move");
+        ctx->root_nodes[col - 1] += ctx->nodes - nodes0;
+        ctx->root_ms[col - 1]    += now_ms() - t0;
+
+        if (search_stopped(ctx)) {
+            break;
+        }
+        if (val > best) {
+            best     = val;
+            best_col = col;
+        }
+        if (val > alpha) {
+            alpha = val;
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    if (!search_stopped(ctx) && ctx->tt && best_col != -1) {
+        TTBound bound = (best <= alpha0) ? TT_BOUND_UPPER
+                      : (best >= beta)   ? TT_BOUND_LOWER
+                      :                    TT_BOUND_EXACT;
+        tt_store(ctx->tt, key, depth, tt_score_to(best, depth), bound,
+                 best_col, &ctx->tt_stats);
+    }
+
+    *out_col = best_col;
+    return best;
+}
+
+/*
+ * Root search with an aspiration window of +/-SEARCH_ASPIRATION around
+ * the previous iteration's score, widened fourfold on each side that
+ * fails until the score lands inside. Shallow iterations and forced
+ * results use the full window.
+ */
+static int search_aspiration(SearchCtx *ctx, SearchPos *pos, Cell bot, int depth,
+                             int prev_score, int first_col, int *out_col) {
+    if (depth < SEARCH_ASPIRATION_MIN_DEPTH ||
+        prev_score > WIN_SCORE / 2 || prev_score < -WIN_SCORE / 2) {
+        return search_root(ctx, pos, bot, depth, -SEARCH_INF, SEARCH_INF,
+                           first_col, 0, out_col);
+    }
+
+    int delta = SEARCH_ASPIRATION;
+    int alpha = prev_score - delta;
+    int beta  = prev_score + delta;
+
+    for (;;) {
+        int score = search_root(ctx, pos, bot, depth, alpha, beta, first_col, 0, out_col);
+        if (search_stopped(ctx)) {
+            return score;
+        }
+
+        if (score <= alpha) {
+            delta *= 4;
+            alpha  = (delta > WIN_SCORE / 4) ? -SEARCH_INF : prev_score - delta;
+        } else if (score >= beta) {
+            delta *= 4;
+            beta   = (delta > WIN_SCORE / 4) ? SEARCH_INF : prev_score + delta;
+            first_col = *out_col;
+        } else {
+            return score;
+        }
+    }
+}
+
+static void search_ctx_init(SearchCtx *ctx, TranspositionTable *tt, SearchShared *sh,
+                            const Board *root) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->tt         = tt;
+    ctx->shared     = sh;
+    ctx->root_moves = root->moves;
+}
+
+/* Fold thread 'id''s counters into st (root columns: thread 0 only)
+   and its table counters into the table. */
+static void search_stats_add(SearchStats *st, SearchCtx *ctx, int id) {
+    st->nodes         += ctx->nodes;
+    st->quiesce_nodes += ctx->qnodes;
+    st->evals         += ctx->evals;
+    st->cutoffs       += ctx->cutoffs;
+    st->first_cutoffs += ctx->first_cutoffs;
+    st->tt_hits       += ctx->tt_stats.hits;
+    st->tt_probes     += ctx->tt_stats.hits + ctx->tt_stats.misses;
+    if (ctx->seldepth > st->seldepth) {
+        st->seldepth = ctx->seldepth;
+    }
+    st->thread_nodes[id] = ctx->nodes;
+    st->threads          = (id + 1 > st->threads) ? id + 1 : st->threads;
+    if (id == 0) {
+        for (int c = 0; c < COLS; c++) {
+            st->root_nodes[c] = ctx->root_nodes[c];
+            st->root_ms[c]    = ctx->root_ms[c];
+        }
+    }
+    if (ctx->tt) {
+        tt_stats_add(ctx->tt, &ctx->tt_stats);
+    }
+}
+
+static void search_shared_init(SearchShared *sh, const SearchLimits *limits, double start) {
+    atomic_init(&sh->stop, false);
+    atomic_init(&sh->can_stop, false);
+    atomic_init(&sh->nodes, 0);
+    sh->max_nodes   = limits->max_nodes;
+    sh->deadline_ms = (limits->time_ms > 0) ? start + limits->time_ms : 0;
+    sh->cancel      = limits->cancel;
+    sh->quiesce     = !limits->no_quiesce;
+}
+
+/*
+ * Lazy SMP helper: iterative deepening on a private board copy until
+ * the main thread raises the stop flag. Its results are only used
+ * through the shared table; odd helpers run one ply deeper so the
+ * threads spread over different depths.
+ */
+typedef struct {
+    SearchPos pos;
+    SearchCtx ctx;
+    Cell      bot;
+    int       id;
+    int       max_depth;
+    PoolTask  task;
+} HelperTask;
+
+static void helper_main(void *arg) {
+    HelperTask *t = (HelperTask*)arg;
+
+    TRACE_BEGIN_ARG("smp_helper", t->id);
+    for (int depth = 1 + (t->id & 1); depth <= t->max_depth; depth++) {
+        int col;
+        search_root(&t->ctx, &t->pos, t->bot, depth, -SEARCH_INF, SEARCH_INF,
+                    0, t->id, &col);
+        if (search_stopped(&t->ctx)) {
+            break;
+        }
+    }
+    TRACE_END("smp_helper");
+}
+
+int search_default_threads(void) {
+    ThreadPool *pool = pool_default();
+    int n = pool ? pool->workers : 1;
+    return (n > SEARCH_MAX_THREADS) ? SEARCH_MAX_THREADS : n;
+}
+
+int search_best_move(const Board *b, Cell bot, const SearchLimits *limits,
+                     SearchResult *out) {
+    double start = now_ms();
+
+    SearchResult res;
+    memset(&res, 0, sizeof(res));
+    res.best_col = -1;
+
+    for (int i = 0; i < COLS; i++) {
+        if (board_height(b, ORDER[i] - 1) < ROWS) {
+            res.best_col = ORDER[i];
+            break;
+        }
+    }
+
+    if (res.best_col != -1) {
+        TRACE_BEGIN("search");
+        SearchShared sh;
+        search_shared_init(&sh, limits, start);
+
+        TranspositionTable *tt = search_tt();
+        if (tt && !limits->same_generation) {
+            tt_new_search(tt);
+        }
+
+        int empty     = ROWS * COLS - __builtin_popcountll(board_mask(b));
+        int max_depth = (limits->max_depth > 0 && limits->max_depth < empty)
+                        ? limits->max_depth : empty;
+
+        int threads = (limits->threads > 0) ? limits->threads : search_default_threads();
+        if (threads > SEARCH_MAX_THREADS) threads = SEARCH_MAX_THREADS;
+
+        /* Helpers run as pool tasks, share the table with the main
+           thread and stop with it. */
+        ThreadPool *pool = (threads > 1) ? pool_default() : NULL;
+        HelperTask  helpers[SEARCH_MAX_THREADS];
+        int         started = 0;
+
+        for (int i = 1; pool && i < threads; i++) {
+            HelperTask *h = &helpers[started++];
+            pos_init(&h->pos, b);
+            h->bot       = bot;
+            h->id        = i;
+            h->max_depth = max_depth;
+            search_ctx_init(&h->ctx, tt, &sh, b);
+            pool_submit(pool, &h->task, helper_main, h);
+        }
+
+        SearchCtx ctx;
+        SearchPos pos;
+        pos_init(&pos, b);
+        search_ctx_init(&ctx, tt, &sh, b);
+
+        for (int depth = 1; depth <= max_depth; depth++) {
+            int col;
+            TRACE_BEGIN_ARG("iteration", depth);
+            int score = search_aspiration(&ctx, &pos, bot, depth,
+                                          res.score, res.best_col, &col);
+            TRACE_END("iteration");
+            if (search_stopped(&ctx) || col == -1) {
+                break;
+            }
+
+            res.best_col = col;
+            res.score    = score;
+            res.depth    = depth;
+            atomic_store(&sh.can_stop, true);
+            if (limits->progress) {
+                search_progress_publish(limits->progress, col, depth, score,
+                                        atomic_load(&sh.nodes) + ctx.unflushed);
+            }
+
+            /* A forced result does not change with more depth. */
+            if (score > WIN_SCORE / 2 || score < -WIN_SCORE / 2) {
+                break;
+            }
+            if (limits->time_ms > 0 && now_ms() >= sh.deadline_ms) {
+                break;
+            }
+        }
+
+        atomic_store(&sh.stop, true);
+        for (int i = 0; i < started; i++) {
+            pool_wait(pool, &helpers[i].task);
+        }
+
+        search_stats_add(&res.stats, &ctx, 0);
+        for (int i = 0; i < started; i++) {
+            search_stats_add(&res.stats, &helpers[i].ctx, helpers[i].id);
+        }
+        TRACE_END("search");
+    }
+
+    res.stats.depth      = res.depth;
+    res.stats.elapsed_ms = now_ms() - start;
+    if (out) {
+        *out = res;
+    }
+    return res.best_col;
+}
+
+/* Plies to the end of a forced root score searched to 'depth', else 0. */
+static int search_forced_plies(int score, int depth) {
+    int mag = (score < 0) ? -score : score;
+    if (mag <= WIN_SCORE / 2) {
+        return 0;
+    }
+    int plies = depth - (mag - WIN_SCORE);
+    return (plies < 1) ? 1 : plies;
+}
+
+int search_rank_columns(const Board *b, Cell bot, const SearchLimits *limits,
+                        SearchRanking *out) {
+    double start = now_ms();
+    Cell   opp   = (bot == CELL_A) ? CELL_B : CELL_A;
+
+    SearchRanking rank;
+    memset(&rank, 0, sizeof(rank));
+    rank.best_col = -1;
+
+    /* Root columns, best of the last completed iteration first. */
+    int moves[COLS];
+    int n = 0;
+    for (int i = 0; i < COLS; i++) {
+        int col = ORDER[i];
+        rank.col_score[col - 1] = SEARCH_NO_SCORE;
+        if (board_height(b, col - 1) < ROWS) {
+            moves[n++] = col;
+        }
+    }
+
+    if (n > 0) {
+        TRACE_BEGIN("rank_columns");
+        SearchShared sh;
+        search_shared_init(&sh, limits, start);
+
+        TranspositionTable *tt = search_tt();
+        if (tt && !limits->same_generation) {
+            tt_new_search(tt);
+        }
+
+        int empty     = ROWS * COLS - __builtin_popcountll(board_mask(b));
+        int max_depth = (limits->max_depth > 0 && limits->max_depth < empty)
+                        ? limits->max_depth : empty;
+
+        SearchCtx ctx;
+        SearchPos pos;
+        pos_init(&pos, b);
+        search_ctx_init(&ctx, tt, &sh, b);
+
+        int  score[COLS];
+        bool forced[COLS] = { false };
+
+        for (int depth = 1; depth <= max_depth; depth++) {
+            bool complete = true;
+            int  open     = 0;
+            TRACE_BEGIN_ARG("iteration", depth);
+
+            for (int i = 0; i < n; i++) {
+                int col = moves[i];
+                if (forced[col - 1]) continue;
+
+                int r;
+                pos_drop(&pos, col, bot, &r);
+                uint64_t nodes0 = ctx.nodes;
+                double   t0     = now_ms();
+                int val = -negamax(&ctx, &pos, depth - 1, -SEARCH_INF, SEARCH_INF,
+                                   bot, opp, r, col - 1);
+                pos_undo(&pos);
+                ctx.root_nodes[col - 1] += ctx.nodes - nodes0;
+                ctx.root_ms[col - 1]    += now_ms() - t0;
+
+                if (search_stopped(&ctx)) {
+                    complete = false;
+                    break;
+                }
+                score[col - 1] = val;
+            }
+            TRACE_END("iteration");
+            if (!complete) {
+                break;
+            }
+
+            for (int i = 0; i < n; i++) {
+                int col = moves[i];
+                if (forced[col - 1]) continue;
+
+                int sc    = score[col - 1];
+                int plies = search_forced_plies(sc, depth);
+                if (plies > 0) {
+                    /* Rescale so columns settled at different depths compare. */
+                    int mag = WIN_SCORE + ROWS * COLS - plies;
+                    sc = (sc > 0) ? mag : -mag;
+                    forced[col - 1] = true;
+                } else {
+                    open++;
+                }
+                rank.col_score[col - 1] = sc;
+                rank.col_plies[col - 1] = plies;
+            }
+            for (int i = 1; i < n; i++) {
+                int col = moves[i];
+                int j   = i;
+                while (j > 0 && rank.col_score[moves[j - 1] - 1] < rank.col_score[col - 1]) {
+                    moves[j] = moves[j - 1];
+                    j--;
+                }
+                moves[j] = col;
+            }
+
+            rank.best_col = moves[0];
+            rank.depth    = depth;
+            atomic_store(&sh.can_stop, true);
+
+            if (limits->progress) {
+                search_progress_publish(limits->progress, rank.best_col, depth,
+                                        rank.col_score[rank.best_col - 1],
+                                        atomic_load(&sh.nodes) + ctx.unflushed);
+            }
+
+            if (open == 0) {
+                break;
+            }
+            if (limits->time_ms > 0 && now_ms() >= sh.deadline_ms) {
+                break;
+            }
+        }
+
+        search_stats_add(&rank.stats, &ctx, 0);
+        TRACE_END("rank_columns");
+    }
+
+    rank.stats.depth      = rank.depth;
+    rank.stats.elapsed_ms = now_ms() - start;
+    if (out) {
+        *out = rank;
+    }
+    return rank.best_col;
+}
@@ -0,0 +1,385 @@
+#define _XOPEN_SOURCE 700
+
+#include "solver.h"
+#include "trace.h"
+#include "tt.h"
+#include <pthread.h>
+#include <stdlib.h>    // getenv, atoi
+#include <string.h>    // memset
+#include <time.h>      // clock_gettime
+
+/*
+ * Exact Connect 4 solver.
+ *
+ * Positions are kept relative to the side to move: 'current' holds the
+ * mover's pieces and 'mask' all pieces, so playing a move is two word
+ * operations and the negamax never needs to know who is A or B.
+ * Scores follow the convention in solver.h.
+ */
+
+#define SOLVER_CELLS          (ROWS * COLS)
+#define SOLVER_CHECK_INTERVAL 4096
+
+static const int ORDER[COLS] = {4, 3, 5, 2, 6, 1, 7};
+
+typedef struct {
+    Bitboard current;  // pieces of the side to move
+    Bitboard mask;     // all pieces
+    int      moves;    // pieces on the board
+} SolverPos;
+
+typedef struct {
+    TranspositionTable *tt;
+    TTStats             tt_stats;
+    uint64_t            nodes;
+    uint64_t            max_nodes;    // 0 = no node budget
+    double              deadline_ms;  // 0 = no time budget
+    atomic_bool        *cancel;       // external abort request, or NULL
+    bool                aborted;
+} Solver;
+
+/* ------------------------------------------------------------------------- */
+/* Solver transposition table                                                */
+/* ------------------------------------------------------------------------- */
+
+/* Solver entries are exact bounds that never go stale, so the table is
+   kept for the whole process (separate from the heuristic search's) and
+   only ages once per game, never per solve. */
+static TranspositionTable g_solver_tt;
+static int                g_solver_tt_ready = 0;
+static pthread_once_t     g_solver_tt_once  = PTHREAD_ONCE_INIT;
+
+/* Size comes from CONNECT4_SOLVER_TT_MB, default SOLVER_TT_SIZE_MB. */
+static void solver_tt_init(void) {
+    size_t mb = SOLVER_TT_SIZE_MB;
+    const char *env = getenv("CONNECT4_SOLVER_TT_MB");
+    if (env && atoi(env) > 0) {
+        mb = (size_t)atoi(env);
+    }
+    g_solver_tt_ready = (tt_init(&g_solver_tt, mb) == 0);
+}
+
+static TranspositionTable *solver_tt(void) {
+    pthread_once(&g_solver_tt_once, solver_tt_init);
+    return g_solver_tt_ready ? &g_solver_tt : NULL;
+}
+
+void solver_new_game(void) {
+    TranspositionTable *tt = solver_tt();
+    if (tt) {
+        tt_new_search(tt);
+    }
+}
+
+void solver_reset(void) {
+    TranspositionTable *tt = solver_tt();
+    if (tt) {
+        tt_clear(tt);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Position helpers                                                          */
+/* ------------------------------------------------------------------------- */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static SolverPos pos_from_board(const Board *b, Cell to_move) {
+    SolverPos p;
+    p.current = b->stones[board_player_index(to_move)];
+    p.mask    = board_mask(b);
+    p.moves   = __builtin_popcountll(p.mask);
+    return p;
+}
+
+/* Play a move given as its cell bit; the opponent becomes the mover. */
+static SolverPos pos_play(const SolverPos *p, Bitboard move) {
+    SolverPos q;
+    q.current = p->current ^ p->mask;
+    q.mask    = p->mask | move;
+    q.moves   = p->moves + 1;
+    return q;
+}
+
+static Bitboard pos_key(const SolverPos *p) {
+    return p->current + p->mask + BOARD_BOTTOM_MASK;
+}
+
+static bool pos_can_win_next(const SolverPos *p) {
+    return (board_winning_cells(p->current, p->mask) & board_playable(p->mask)) != 0;
+}
+
+/*
+ * Moves that do not hand the opponent an immediate win. If the
+ * opponent has two immediate wins, there are none. If it has one,
+ * the block is the only candidate.
+ */
+static Bitboard pos_non_losing_moves(const SolverPos *p) {
+    Bitboard possible = board_playable(p->mask);
+    Bitboard opp_win  = board_winning_cells(p->current ^ p->mask, p->mask);
+    Bitboard forced   = possible & opp_win;
+
+    if (forced) {
+        if (forced & (forced - 1)) {
+            return 0;
+        }
+        possible = forced;
+    }
+
+    /* never play directly below an opponent winning cell */
+    return possible & ~(opp_win >> 1);
+}
+
+/* Ordering score: how many winning cells the move creates. */
+static int pos_move_score(const SolverPos *p, Bitboard move) {
+    return __builtin_popcountll(board_winning_cells(p->current | move, p->mask));
+}
+
+/* ------------------------------------------------------------------------- */
+/* Negamax                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static bool solver_tick(Solver *s) {
+    s->nodes++;
+    if ((s->nodes % SOLVER_CHECK_INTERVAL) == 0) {
+        if ((s->cancel && atomic_load_explicit(s->cancel, memory_order_relaxed)) ||
+            (s->max_nodes > 0 && s->nodes >= s->max_nodes) ||
+            (s->deadline_ms > 0 && now_ms() >= s->deadline_ms)) {
+            s->aborted = true;
+        }
+    }
+    return s->aborted;
+}
+
+/*
+ * Score of p within (alpha, beta), fail-hard. The side to move must
+ * not have an immediate win (callers check pos_can_win_next first;
+ * inside the tree, non-losing moves guarantee it).
+ */
+static int negamax(Solver *s, const SolverPos *p, int alpha, int beta) {
+    if (solver_tick(s)) {
+        return 0;
+    }
+
+    Bitboard next = pos_non_losing_moves(p);
+    if (next == 0) {
+        return -(SOLVER_CELLS - p->moves) / 2;
+    }
+    if (p->moves >= SOLVER_CELLS - 2) {
+        return 0;
+    }
+
+    int min = -(SOLVER_CELLS - 2 - p->moves) / 2;
+    if (alpha < min) {
+        alpha = min;
+        if (alpha >= beta) return alpha;
+    }
+
+    int max = (SOLVER_CELLS - 1 - p->moves) / 2;
+    if (beta > max) {
+        beta = max;
+        if (alpha >= beta) return beta;
+    }
+
+    Bitboard key = pos_key(p);
+    TTEntry  e;
+    if (s->tt && tt_probe(s->tt, key, &e, &s->tt_stats)) {
+        if (e.bound == TT_BOUND_LOWER && alpha < e.score) {
+            alpha = e.score;
+            if (alpha >= beta) return alpha;
+        } else if (e.bound == TT_BOUND_UPPER && beta > e.score) {
+            beta = e.score;
+            if (alpha >= beta) return beta;
+        }
+    }
+
+    /* Sort candidates by created threats, center first on ties. */
+    Bitboard moves[COLS];
+    int      scores[COLS];
+    int      n = 0;
+
+    for (int i = 0; i < COLS; i++) {
+        Bitboard move = next & board_column_mask(ORDER[i] - 1);
+        if (!move) continue;
+
+        int sc = pos_move_score(p, move);
+        int j  = n++;
+        while (j > 0 && scores[j - 1] < sc) {
+            moves[j]  = moves[j - 1];
+            scores[j] = scores[j - 1];
+            j--;
+        }
+        moves[j]  = move;
+        scores[j] = sc;
+    }
+
+    int remaining = SOLVER_CELLS - p->moves;
+
+    for (int i = 0; i < n; i++) {
+        SolverPos child = pos_play(p, moves[i]);
+        int score = -negamax(s, &child, -beta, -alpha);
+
+        if (s->aborted) {
+            return 0;
+        }
+        if (score >= beta) {
+            if (s->tt) {
+                tt_store(s->tt, key, remaining, score, TT_BOUND_LOWER, 0, &s->tt_stats);
+            }
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+    }
+
+    if (s->tt) {
+        tt_store(s->tt, key, remaining, alpha, TT_BOUND_UPPER, 0, &s->tt_stats);
+    }
+    return alpha;
+}
+
+/*
+ * Exact score by null-window probes: each probe halves the interval of
+ * possible scores, biased toward zero where most positions lie.
+ */
+static int solve_pos(Solver *s, const SolverPos *p) {
+    if (pos_can_win_next(p)) {
+        return (SOLVER_CELLS + 1 - p->moves) / 2;
+    }
+
+    int min = -(SOLVER_CELLS - p->moves) / 2;
+    int max = (SOLVER_CELLS + 1 - p->moves) / 2;
+
+    while (min < max) {
+        int med = min + (max - min) / 2;
+        if (med <= 0 && min / 2 < med) {
+            med = min / 2;
+        } else if (med >= 0 && max / 2 > med) {
+            med = max / 2;
+        }
+
+        int r = negamax(s, p, med, med + 1);
+        if (s->aborted) {
+            return 0;
+        }
+
+        if (r <= med) {
+            max = r;
+        } else {
+            min = r;
+        }
+    }
+
+    return min;
+}
+
+static void solver_begin(Solver *s, const SolverLimits *limits, double start) {
+    memset(s, 0, sizeof(*s));
+    s->tt = solver_tt();
+    if (limits) {
+        s->max_nodes   = limits->max_nodes;
+        s->deadline_ms = (limits->time_ms > 0) ? start + limits->time_ms : 0;
+        s->cancel      = limits->cancel;
+    }
+}
+
+static void solver_end(Solver *s) {
+    if (s->tt) {
+        tt_stats_add(s->tt, &s->tt_stats);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Public API                                                                */
+/* ------------------------------------------------------------------------- */
+
+int solver_plies_to_end(int score, int moves) {
+    if (score > 0) {
+        /* mover wins with its k-th piece and has moves/2 pieces now */
+        int k = SOLVER_CELLS / 2 + 1 - score;
+        return 2 * (k - moves / 2) - 1;
+    }
+    if (score < 0) {
+        /* opponent wins with its k-th piece and has (moves+1)/2 now */
+        int k = SOLVER_CELLS / 2 + 1 + score;
+        return 2 * (k - (moves + 1) / 2);
+    }
+    return SOLVER_CELLS - moves;
+}
+
+bool solver_score(const Board *b, Cell to_move, const SolverLimits *limits,
+                  int *out_score, uint64_t *out_nodes) {
+    Solver    s;
+    SolverPos p = pos_from_board(b, to_move);
+
+    solver_begin(&s, limits, now_ms());
+    int score = solve_pos(&s, &p);
+    solver_end(&s);
+
+    if (out_score) *out_score = score;
+    if (out_nodes) *out_nodes = s.nodes;
+    return !s.aborted;
+}
+
+bool solver_solve(const Board *b, Cell to_move, const SolverLimits *limits,
+                  SolverResult *out) {
+    double    start = now_ms();
+    Solver    s;
+    SolverPos p = pos_from_board(b, to_move);
+
+    TRACE_BEGIN("solve");
+    solver_begin(&s, limits, start);
+
+    SolverResult res;
+    res.solved   = false;
+    res.score    = 0;
+    res.plies    = 0;
+    res.best_col = -1;
+
+    Bitboard possible = board_playable(p.mask);
+    Bitboard wins     = board_winning_cells(p.current, p.mask) & possible;
+
+    for (int c = 0; c < COLS; c++) {
+        res.col_score[c] = SOLVER_INVALID;
+    }
+
+    for (int i = 0; i < COLS && !s.aborted; i++) {
+        int      c    = ORDER[i] - 1;
+        Bitboard move = possible & board_column_mask(c);
+        if (!move) continue;
+
+        int score;
+        if (wins & move) {
+            score = (SOLVER_CELLS + 1 - p.moves) / 2;
+        } else {
+            SolverPos child = pos_play(&p, move);
+            score = -solve_pos(&s, &child);
+        }
+
+        if (s.aborted) break;
+
+        res.col_score[c] = score;
+        if (res.best_col == -1 || score > res.score) {
+            res.best_col = c + 1;
+            res.score    = score;
+        }
+    }
+
+    solver_end(&s);
+
+    res.solved     = !s.aborted && res.best_col != -1;
+    res.plies      = res.solved ? solver_plies_to_end(res.score, p.moves) : 0;
+    res.nodes      = s.nodes;
+    res.elapsed_ms = now_ms() - start;
+
+    if (out) {
+        *out = res;
+    }
+    TRACE_END("solve");
+    return res.solved;
+}
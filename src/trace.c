@@ -0,0 +1,217 @@
+#define _XOPEN_SOURCE 700
+
+#include "trace.h"
+
+#ifdef CONNECT4_TRACE
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>    // getenv, malloc, free
+#include <string.h>    // strncpy
+#include <time.h>      // clock_gettime
+
+#define TRACE_MASK (TRACE_RING_EVENTS - 1)
+
+typedef struct {
+    uint64_t    ts_ns;
+    const char *name;
+    int64_t     arg;
+    char        phase;
+} TraceEvent;
+
+/* A ring slot: TraceEvent with fields a dump may read while the owner
+   rewrites them (relaxed stores compile to plain moves). */
+typedef struct {
+    _Atomic uint64_t      ts_ns;
+    _Atomic(const char *) name;
+    _Atomic int64_t       arg;
+    _Atomic char          phase;
+} TraceSlot;
+
+/* One thread's events. Only the owner writes; it publishes each event
+   by advancing 'head' with release order, and a dump reads behind it. */
+typedef struct TraceRing {
+    _Atomic uint64_t  head;       // events ever written
+    int               tid;
+    char              name[32];
+    struct TraceRing *next;       // registry link
+    TraceSlot         events[TRACE_RING_EVENTS];
+} TraceRing;
+
+static _Thread_local TraceRing *t_ring = NULL;
+
+static TraceRing       *g_rings    = NULL;   // registry, newest first
+static int              g_next_tid = 1;
+static pthread_mutex_t  g_lock     = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool      g_enabled  = true;
+static uint64_t         g_start_ns = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* The calling thread's ring, registered on first use; NULL if out of memory. */
+static TraceRing *trace_ring(void) {
+    if (t_ring) {
+        return t_ring;
+    }
+
+    TraceRing *r = malloc(sizeof(*r));
+    if (!r) {
+        return NULL;
+    }
+    atomic_init(&r->head, 0);
+    r->name[0] = '\0';
+
+    pthread_mutex_lock(&g_lock);
+    if (!g_rings) {
+        g_start_ns = now_ns();
+    }
+    r->tid  = g_next_tid++;
+    r->next = g_rings;
+    g_rings = r;
+    pthread_mutex_unlock(&g_lock);
+
+    t_ring = r;
+    return r;
+}
+
+void trace_event(const char *name, char phase, int64_t arg) {
+    if (!atomic_load_explicit(&g_enabled, memory_order_relaxed)) {
+        return;
+    }
+    TraceRing *r = trace_ring();
+    if (!r) {
+        return;
+    }
+
+    uint64_t   i = atomic_load_explicit(&r->head, memory_order_relaxed);
+    TraceSlot *e = &r->events[i & TRACE_MASK];
+    atomic_store_explicit(&e->ts_ns, now_ns(), memory_order_relaxed);
+    atomic_store_explicit(&e->name,  name,     memory_order_relaxed);
+    atomic_store_explicit(&e->arg,   arg,      memory_order_relaxed);
+    atomic_store_explicit(&e->phase, phase,    memory_order_relaxed);
+    atomic_store_explicit(&r->head, i + 1, memory_order_release);
+}
+
+void trace_thread_name(const char *name) {
+    TraceRing *r = trace_ring();
+    if (r) {
+        strncpy(r->name, name, sizeof(r->name) - 1);
+        r->name[sizeof(r->name) - 1] = '\0';
+    }
+}
+
+void trace_set_enabled(bool on) {
+    atomic_store(&g_enabled, on);
+}
+
+uint64_t trace_event_count(void) {
+    uint64_t n = 0;
+    pthread_mutex_lock(&g_lock);
+    for (TraceRing *r = g_rings; r; r = r->next) {
+        n += atomic_load_explicit(&r->head, memory_order_acquire);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return n;
+}
+
+/*
+ * Write the ring's events that were still intact after copying them out.
+ * The owner writes event j only after publishing head = j, so if the
+ * copy saw any of event j's fields, the head read after the acquire
+ * fence is at least j and the slot is skipped below.
+ */
+static void dump_ring(FILE *f, TraceRing *r, TraceEvent *copy, bool *first) {
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint64_t from = (head > TRACE_RING_EVENTS) ? head - TRACE_RING_EVENTS : 0;
+
+    for (uint64_t i = from; i < head; i++) {
+        TraceSlot  *s = &r->events[i & TRACE_MASK];
+        TraceEvent *e = &copy[i - from];
+        e->ts_ns = atomic_load_explicit(&s->ts_ns, memory_order_relaxed);
+        e->name  = atomic_load_explicit(&s->name,  memory_order_relaxed);
+        e->arg   = atomic_load_explicit(&s->arg,   memory_order_relaxed);
+        e->phase = atomic_load_explicit(&s->phase, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    /* Slots the owner reused while we copied (or is writing now) hold
+       newer events; skip them. */
+    uint64_t now   = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint64_t begin = from;
+    if (now + 1 > from + TRACE_RING_EVENTS) {
+        begin = now + 1 - TRACE_RING_EVENTS;
+    }
+
+    if (r->name[0]) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":\"%s\"}}", *first ? "" : ",\n", r->tid, r->name);
+        *first = false;
+    }
+
+    for (uint64_t i = begin; i < head; i++) {
+        const TraceEvent *e = &copy[i - from];
+        double ts = (e->ts_ns >= g_start_ns) ? (double)(e->ts_ns - g_start_ns) / 1000.0 : 0.0;
+
+        fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                *first ? "" : ",\n", e->name, e->phase, ts, r->tid);
+        if (e->phase == 'i') {
+            fprintf(f, ",\"s\":\"t\"");
+        }
+        if (e->arg != 0) {
+            fprintf(f, ",\"args\":{\"v\":%lld}", (long long)e->arg);
+        }
+        fputc('}', f);
+        *first = false;
+    }
+}
+
+int trace_dump(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+
+    TraceEvent *copy = malloc(sizeof(TraceEvent) * TRACE_RING_EVENTS);
+    if (!copy) {
+        fclose(f);
+        return -1;
+    }
+
+    bool first = true;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    pthread_mutex_lock(&g_lock);
+    for (TraceRing *r = g_rings; r; r = r->next) {
+        dump_ring(f, r, copy, &first);
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    fprintf(f, "\n]}\n");
+    free(copy);
+    return (fclose(f) == 0) ? 0 : -1;
+}
+
+void trace_dump_default(void) {
+    const char *path = getenv("CONNECT4_TRACE_FILE");
+    if (!path || !*path) {
+        path = TRACE_DEFAULT_PATH;
+    }
+    if (trace_dump(path) == 0) {
+        printf("Trace written to %s (%llu events).\n", path,
+               (unsigned long long)trace_event_count());
+    } else {
+        perror(path);
+    }
+}
+
+#else
+
+/* ISO C forbids an empty translation unit. */
+typedef int trace_compiled_out;
+
+#endif /* CONNECT4_TRACE */
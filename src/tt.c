@@ -0,0 +1,176 @@
+#include "tt.h"
+#include <stdlib.h>    // aligned_alloc, free
+#include <string.h>    // memset
+
+/*
+ * Packed slot data (64 bits):
+ *   bits  0..31  score (two's complement)
+ *   bits 32..39  depth
+ *   bits 40..41  bound
+ *   bits 42..45  best move (column 1..COLS, 0 = none)
+ *   bits 48..55  generation
+ */
+#define TT_SHIFT_DEPTH 32
+#define TT_SHIFT_BOUND 40
+#define TT_SHIFT_MOVE  42
+#define TT_SHIFT_GEN   48
+
+static uint64_t tt_pack(int depth, int score, TTBound bound, int move, uint8_t gen) {
+    return  (uint64_t)(uint32_t)score
+         | ((uint64_t)(uint8_t)depth    << TT_SHIFT_DEPTH)
+         | ((uint64_t)(bound & 0x3)     << TT_SHIFT_BOUND)
+         | ((uint64_t)(move  & 0xF)     << TT_SHIFT_MOVE)
+         | ((uint64_t)gen               << TT_SHIFT_GEN);
+}
+
+static TTBound tt_data_bound(uint64_t data) {
+    return (TTBound)((data >> TT_SHIFT_BOUND) & 0x3);
+}
+
+static int tt_data_depth(uint64_t data) {
+    return (int)(uint8_t)(data >> TT_SHIFT_DEPTH);
+}
+
+static uint8_t tt_data_gen(uint64_t data) {
+    return (uint8_t)(data >> TT_SHIFT_GEN);
+}
+
+/* Spread the key bits before masking out a bucket index. */
+static size_t tt_index(const TranspositionTable *tt, uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (size_t)key & (tt->bucket_count - 1);
+}
+
+int tt_init(TranspositionTable *tt, size_t size_mb) {
+    size_t bytes = size_mb * 1024 * 1024;
+    size_t count = 1;
+
+    while (count * 2 * sizeof(TTBucket) <= bytes) {
+        count *= 2;
+    }
+
+    tt->buckets = aligned_alloc(sizeof(TTBucket), count * sizeof(TTBucket));
+    if (!tt->buckets) {
+        tt->bucket_count = 0;
+        return -1;
+    }
+
+    tt->bucket_count = count;
+    tt_clear(tt);
+    return 0;
+}
+
+void tt_free(TranspositionTable *tt) {
+    free(tt->buckets);
+    tt->buckets      = NULL;
+    tt->bucket_count = 0;
+}
+
+void tt_clear(TranspositionTable *tt) {
+    memset(tt->buckets, 0, tt->bucket_count * sizeof(TTBucket));
+    atomic_store_explicit(&tt->generation, 0, memory_order_relaxed);
+    atomic_store(&tt->hits, 0);
+    atomic_store(&tt->misses, 0);
+    atomic_store(&tt->collisions, 0);
+}
+
+void tt_new_search(TranspositionTable *tt) {
+    atomic_fetch_add_explicit(&tt->generation, 1, memory_order_relaxed);
+}
+
+bool tt_probe(const TranspositionTable *tt, uint64_t key, TTEntry *out,
+              TTStats *stats) {
+    const TTBucket *bucket = &tt->buckets[tt_index(tt, key)];
+
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        const TTSlot *slot = &bucket->slots[i];
+        uint64_t data  = atomic_load_explicit(&slot->data,  memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+
+        if ((check ^ data) != key || tt_data_bound(data) == TT_BOUND_NONE) {
+            continue;
+        }
+
+        out->score = (int)(int32_t)(uint32_t)data;
+        out->depth = tt_data_depth(data);
+        out->bound = tt_data_bound(data);
+        out->move  = (int)((data >> TT_SHIFT_MOVE) & 0xF);
+        stats->hits++;
+        return true;
+    }
+
+    stats->misses++;
+    return false;
+}
+
+void tt_store(TranspositionTable *tt, uint64_t key, int depth, int score,
+              TTBound bound, int move, TTStats *stats) {
+    TTBucket *bucket = &tt->buckets[tt_index(tt, key)];
+    uint8_t   gen    = atomic_load_explicit(&tt->generation, memory_order_relaxed);
+
+    /* Victim: the slot already holding key, else an empty slot, else the
+       shallowest entry with older generations counting as shallower. */
+    TTSlot  *victim      = NULL;
+    uint64_t victim_data = 0;
+    int      victim_rank = 0;
+
+    for (int i = 0; i < TT_BUCKET_ENTRIES; i++) {
+        TTSlot  *slot  = &bucket->slots[i];
+        uint64_t data  = atomic_load_explicit(&slot->data,  memory_order_relaxed);
+        uint64_t check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+
+        if (tt_data_bound(data) == TT_BOUND_NONE) {
+            victim      = slot;
+            victim_data = 0;
+            break;
+        }
+
+        if ((check ^ data) == key) {
+            /* Same position: keep a much deeper entry of this generation,
+               and an exact one against a bound no deeper than it. */
+            int  old_depth = tt_data_depth(data);
+            bool keep      = (bound != TT_BOUND_EXACT && tt_data_bound(data) == TT_BOUND_EXACT)
+                             ? depth <= old_depth
+                             : depth < old_depth - TT_REPLACE_MARGIN;
+            if (keep && tt_data_gen(data) == gen) {
+                return;
+            }
+            if (move == 0) {
+                move = (int)((data >> TT_SHIFT_MOVE) & 0xF);
+            }
+            victim      = slot;
+            victim_data = 0;
+            break;
+        }
+
+        int age  = (uint8_t)(gen - tt_data_gen(data));
+        int rank = tt_data_depth(data) - 8 * age;
+        if (!victim || rank < victim_rank) {
+            victim      = slot;
+            victim_data = data;
+            victim_rank = rank;
+        }
+    }
+
+    if (victim_data != 0 && tt_data_gen(victim_data) == gen) {
+        stats->collisions++;
+    }
+
+    uint64_t data = tt_pack(depth, score, bound, move, gen);
+    atomic_store_explicit(&victim->data,  data,       memory_order_relaxed);
+    atomic_store_explicit(&victim->check, key ^ data, memory_order_relaxed);
+}
+
+void tt_stats_add(TranspositionTable *tt, const TTStats *stats) {
+    atomic_fetch_add_explicit(&tt->hits,       stats->hits,       memory_order_relaxed);
+    atomic_fetch_add_explicit(&tt->misses,     stats->misses,     memory_order_relaxed);
+    atomic_fetch_add_explicit(&tt->collisions, stats->collisions, memory_order_relaxed);
+}
+
+void tt_stats_get(const TranspositionTable *tt, TTStats *out) {
+    out->hits       = atomic_load_explicit(&tt->hits,       memory_order_relaxed);
+    out->misses     = atomic_load_explicit(&tt->misses,     memory_order_relaxed);
+    out->collisions = atomic_load_explicit(&tt->collisions, memory_order_relaxed);
+}
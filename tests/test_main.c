@@ -1,7 +1,24 @@
 // test_main.c
+#define _XOPEN_SOURCE 700
+
 #include <assert.h>
+#include <stddef.h>    // offsetof
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>    // memcmp
 #include "board.h"
+#include "tt.h"
+#include "search.h"
+#include "solver.h"
+#include "book.h"
+#include "eval.h"
+#include "pool.h"
+#include "batch.h"
+#include "mcts.h"
+#include "ponder.h"
+#include "bot.h"
+#include <pthread.h>
+#include <time.h>
 
 // Small helper: drop at 1-based column 'col' for player 'p'
 static int drop(Board *b, int col, Cell p, int *out_row_zero_based, int *out_col_zero_based) {
@@ -67,10 +84,909 @@ static void test_diag_slash_win(void) {
     assert(board_is_winning(&b, r, c, CELL_A));
 }
 
+static void test_no_wrap_across_columns(void) {
+    // Three A's at the top of column 1 and one at the bottom of column 2
+    // are adjacent bits in a naive bitboard; the sentinel row must keep
+    // them from counting as a vertical four.
+    Board b; board_init(&b);
+    int r, c;
+
+    assert(drop(&b, 1, CELL_B, NULL, NULL));
+    assert(drop(&b, 1, CELL_B, NULL, NULL));
+    assert(drop(&b, 1, CELL_B, NULL, NULL));
+    assert(drop(&b, 1, CELL_A, NULL, NULL));
+    assert(drop(&b, 1, CELL_A, NULL, NULL));
+    assert(drop(&b, 1, CELL_A, NULL, NULL));
+    assert(drop(&b, 2, CELL_A, &r, &c));
+    assert(!board_is_winning(&b, r, c, CELL_A));
+
+    // Horizontal A A . A is not a win either.
+    Board h; board_init(&h);
+    assert(drop(&h, 3, CELL_A, NULL, NULL));
+    assert(drop(&h, 4, CELL_A, NULL, NULL));
+    assert(drop(&h, 6, CELL_A, &r, &c));
+    assert(!board_is_winning(&h, r, c, CELL_A));
+}
+
+static void test_cells_heights_and_full(void) {
+    Board b; board_init(&b);
+    int r;
+
+    assert(!board_is_full(&b));
+    assert(board_drop(&b, 7, CELL_B, &r));
+    assert(r == ROWS - 1);
+    assert(board_cell(&b, ROWS - 1, 6) == CELL_B);
+    assert(board_cell(&b, ROWS - 2, 6) == CELL_EMPTY);
+    assert(board_height(&b, 6) == 1);
+
+    for (int col = 1; col <= COLS; col++) {
+        while (board_height(&b, col - 1) < ROWS) {
+            Cell p = ((col + board_height(&b, col - 1)) % 2) ? CELL_A : CELL_B;
+            assert(board_drop(&b, col, p, &r));
+        }
+        assert(!board_drop(&b, col, CELL_A, &r));
+    }
+    assert(board_is_full(&b));
+    assert(!board_drop(&b, 0, CELL_A, &r));
+    assert(!board_drop(&b, COLS + 1, CELL_A, &r));
+}
+
+static void test_undo_restores_position(void) {
+    Board b; board_init(&b);
+    int r, col;
+
+    assert(!board_undo(&b, &col));
+
+    assert(drop(&b, 4, CELL_A, NULL, NULL));
+    Board before = b;
+
+    assert(drop(&b, 4, CELL_B, &r, NULL));
+    assert(drop(&b, 5, CELL_A, NULL, NULL));
+    assert(b.moves == 3);
+
+    assert(board_undo(&b, &col));
+    assert(col == 5);
+    assert(board_undo(&b, &col));
+    assert(col == 4);
+    assert(board_cell(&b, r, 3) == CELL_EMPTY);
+
+    assert(b.moves == before.moves);
+    assert(b.stones[0] == before.stones[0]);
+    assert(b.stones[1] == before.stones[1]);
+}
+
+static void test_tt_store_and_probe(void) {
+    TranspositionTable tt;
+    TTStats st = {0};
+    TTEntry e;
+    assert(tt_init(&tt, 1) == 0);
+
+    Board b; board_init(&b);
+    assert(drop(&b, 4, CELL_A, NULL, NULL));
+    uint64_t k1 = board_key(&b);
+    assert(drop(&b, 3, CELL_B, NULL, NULL));
+    uint64_t k2 = board_key(&b);
+    assert(k1 != k2);
+
+    assert(!tt_probe(&tt, k1, &e, &st));
+    tt_store(&tt, k1, 5, -42, TT_BOUND_LOWER, 3, &st);
+    assert(tt_probe(&tt, k1, &e, &st));
+    assert(e.score == -42 && e.depth == 5 && e.bound == TT_BOUND_LOWER && e.move == 3);
+    assert(!tt_probe(&tt, k2, &e, &st));
+    assert(st.hits == 1 && st.misses == 2);
+
+    tt_stats_add(&tt, &st);
+    TTStats total;
+    tt_stats_get(&tt, &total);
+    assert(total.hits == 1 && total.misses == 2);
+
+    // A much shallower bound leaves the entry alone; a near one replaces
+    // it but keeps the move, and so does a near exact result.
+    tt_store(&tt, k1, 1, 7, TT_BOUND_UPPER, 0, &st);
+    assert(tt_probe(&tt, k1, &e, &st) && e.depth == 5 && e.score == -42);
+    tt_store(&tt, k1, 5 - TT_REPLACE_MARGIN, 7, TT_BOUND_UPPER, 0, &st);
+    assert(tt_probe(&tt, k1, &e, &st));
+    assert(e.depth == 5 - TT_REPLACE_MARGIN && e.bound == TT_BOUND_UPPER && e.move == 3);
+    tt_store(&tt, k1, 5 - 2 * TT_REPLACE_MARGIN, 9, TT_BOUND_EXACT, 2, &st);
+    assert(tt_probe(&tt, k1, &e, &st) && e.bound == TT_BOUND_EXACT && e.move == 2);
+
+    // A deep exact entry survives shallow exact results and bounds of
+    // its own depth.
+    tt_store(&tt, k1, 20, 11, TT_BOUND_EXACT, 5, &st);
+    tt_store(&tt, k1, 3, 12, TT_BOUND_EXACT, 6, &st);
+    tt_store(&tt, k1, 0, 13, TT_BOUND_EXACT, 0, &st);
+    tt_store(&tt, k1, 20, 14, TT_BOUND_LOWER, 6, &st);
+    assert(tt_probe(&tt, k1, &e, &st));
+    assert(e.depth == 20 && e.score == 11 && e.bound == TT_BOUND_EXACT && e.move == 5);
+
+    // A new generation makes any store replace the old entry.
+    tt_store(&tt, k1, 21, 1, TT_BOUND_LOWER, 4, &st);
+    tt_new_search(&tt);
+    tt_store(&tt, k1, 1, 2, TT_BOUND_UPPER, 0, &st);
+    assert(tt_probe(&tt, k1, &e, &st) && e.depth == 1 && e.move == 4);
+
+    tt_clear(&tt);
+    assert(!tt_probe(&tt, k1, &e, &st));
+    tt_free(&tt);
+}
+
+typedef struct {
+    Board board;
+    Cell  turn;
+    int   expected;
+} SolveCase;
+
+static void *solve_case_twice(void *arg) {
+    const SolveCase *c = (const SolveCase*)arg;
+    for (int i = 0; i < 2; i++) {
+        int score;
+        assert(solver_score(&c->board, c->turn, NULL, &score, NULL));
+        assert(score == c->expected);
+    }
+    return NULL;
+}
+
+/* Threads solving at once share the solver table (as book_gen does). */
+static void test_solver_concurrent_solves(void) {
+    static const char *SEQ[] = {   // bench/positions/solver_{mid,end}.txt
+        "2174253662272124", "336641141437755743",
+        "75342245134333377221762665772661", "45723367226261342323744116667",
+    };
+    SolveCase cases[4];
+
+    solver_reset();
+    for (int i = 0; i < 4; i++) {
+        board_init(&cases[i].board);
+        int n = board_play_sequence(&cases[i].board, SEQ[i]);
+        assert(n > 0);
+        cases[i].turn = (n % 2 == 0) ? CELL_A : CELL_B;
+        assert(solver_score(&cases[i].board, cases[i].turn, NULL, &cases[i].expected, NULL));
+    }
+
+    solver_reset();
+    solver_new_game();
+    pthread_t tids[4];
+    for (int i = 0; i < 4; i++) {
+        assert(pthread_create(&tids[i], NULL, solve_case_twice, &cases[i]) == 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(tids[i], NULL);
+    }
+}
+
+static void test_search_finds_forced_win(void) {
+    Board b; board_init(&b);
+    SearchResult res;
+
+    // A: 1,2,3 on the bottom row; B stacked on top. A wins in column 4.
+    assert(drop(&b, 1, CELL_A, NULL, NULL));
+    assert(drop(&b, 1, CELL_B, NULL, NULL));
+    assert(drop(&b, 2, CELL_A, NULL, NULL));
+    assert(drop(&b, 2, CELL_B, NULL, NULL));
+    assert(drop(&b, 3, CELL_A, NULL, NULL));
+    assert(drop(&b, 6, CELL_B, NULL, NULL));
+
+    SearchLimits depth_only = { .max_depth = 4, .time_ms = 0, .max_nodes = 0 };
+    assert(search_best_move(&b, CELL_A, &depth_only, &res) == 4);
+    assert(res.score > WIN_SCORE / 2);
+    assert(res.depth >= 1 && res.stats.nodes > 0);
+
+    // Counters add up: per thread and per root column.
+    SearchLimits two = { .max_depth = 6, .time_ms = 0, .max_nodes = 0, .threads = 2 };
+    search_new_game();
+    search_best_move(&b, CELL_B, &two, &res);
+    const SearchStats *st = &res.stats;
+    uint64_t per_thread = 0, per_col = 0;
+    for (int i = 0; i < st->threads; i++) per_thread += st->thread_nodes[i];
+    for (int c = 0; c < COLS; c++) per_col += st->root_nodes[c];
+    assert(st->depth == res.depth && st->seldepth >= st->depth);
+    assert(per_thread == st->nodes && per_col <= st->thread_nodes[0]);
+    assert(st->evals > 0 && st->evals < st->nodes);
+    assert(st->tt_hits <= st->tt_probes && st->first_cutoffs <= st->cutoffs);
+    assert(st->elapsed_ms > 0);
+
+    // A tiny time budget still returns a legal move from depth 1.
+    SearchLimits tiny = { .max_depth = 0, .time_ms = 1, .max_nodes = 1 };
+    int col = search_best_move(&b, CELL_B, &tiny, &res);
+    assert(col >= 1 && col <= COLS);
+    assert(res.depth >= 1);
+}
+
+static void test_quiescence_follows_forced_moves(void) {
+    // A to move can open a three with both ends free (columns 3 or 6):
+    // the win lands three plies out, past a depth-1 horizon.
+    Board b; board_init(&b);
+    assert(board_play_sequence(&b, "4455") == 4);
+
+    SearchResult res;
+    SearchLimits plain = { .max_depth = 1, .time_ms = 0, .max_nodes = 0, .no_quiesce = true };
+    search_best_move(&b, CELL_A, &plain, &res);
+    assert(res.score < WIN_SCORE / 2);
+    assert(res.stats.quiesce_nodes == 0);
+
+    SearchLimits quiesce = { .max_depth = 1, .time_ms = 0, .max_nodes = 0 };
+    int col = search_best_move(&b, CELL_A, &quiesce, &res);
+    assert(col == 3 || col == 6);
+    assert(res.score > WIN_SCORE / 2);
+    assert(res.stats.quiesce_nodes > 0);   // e.g. B's block after A plays 7
+
+    // After 3, B cannot cover both ends: lost even at depth 1.
+    assert(board_play_sequence(&b, "3") == 1);
+    search_new_game();
+    search_best_move(&b, CELL_B, &quiesce, &res);
+    assert(res.score < -WIN_SCORE / 2);
+}
+
+static void test_play_sequence_and_winning_cells(void) {
+    Board b; board_init(&b);
+
+    assert(board_play_sequence(&b, "4455") == 4);
+    assert(board_cell(&b, ROWS - 1, 3) == CELL_A);
+    assert(board_cell(&b, ROWS - 2, 3) == CELL_B);
+
+    // A threatens both ends of 4-5 on the bottom row after 3.
+    assert(board_play_sequence(&b, "3") == 1);
+    Bitboard wins = board_winning_cells(b.stones[0], board_mask(&b));
+    assert(wins & board_cell_bit(ROWS - 1, 1));
+    assert(wins & board_cell_bit(ROWS - 1, 5));
+    assert((wins & board_playable(board_mask(&b))) == wins);
+
+    Board bad; board_init(&bad);
+    assert(board_play_sequence(&bad, "48") == -1);
+    board_init(&bad);
+    assert(board_play_sequence(&bad, "1212121") == 7);    // may end with a win
+    board_init(&bad);
+    assert(board_play_sequence(&bad, "12121213") == -1);  // game over at move 7
+}
+
+/* Plain negamax over every line of play, in solver score units. */
+static int brute_force_score(Board *b, Cell me) {
+    Cell opp   = (me == CELL_A) ? CELL_B : CELL_A;
+    int  moves = __builtin_popcountll(board_mask(b));
+
+    for (int c = 0; c < COLS; c++) {
+        int h = board_height(b, c);
+        if (h < ROWS && board_is_winning(b, ROWS - 1 - h, c, me)) {
+            return (ROWS * COLS + 1 - moves) / 2;
+        }
+    }
+    if (board_is_full(b)) return 0;
+
+    int best = -ROWS * COLS;
+    for (int c = 1; c <= COLS; c++) {
+        if (!board_drop(b, c, me, NULL)) continue;
+        int v = -brute_force_score(b, opp);
+        board_undo(b, NULL);
+        if (v > best) best = v;
+    }
+    return best;
+}
+
+static void test_solver_matches_brute_force(void) {
+    srand(12345);
+    int checked = 0;
+
+    while (checked < 40) {
+        Board b; board_init(&b);
+        Cell turn = CELL_A;
+        int  over = 0;
+
+        // Random game down to 9 empty cells, discarding finished games.
+        while (__builtin_popcountll(board_mask(&b)) < ROWS * COLS - 9) {
+            int col = 1 + rand() % COLS, r;
+            if (!board_drop(&b, col, turn, &r)) continue;
+            if (board_is_winning(&b, r, col - 1, turn)) { over = 1; break; }
+            turn = (turn == CELL_A) ? CELL_B : CELL_A;
+        }
+        if (over) continue;
+
+        SolverResult res;
+        assert(solver_solve(&b, turn, NULL, &res));
+        assert(res.score == brute_force_score(&b, turn));
+
+        int score;
+        assert(solver_score(&b, turn, NULL, &score, NULL));
+        assert(score == res.score);
+        checked++;
+    }
+}
+
+static void test_book_roundtrip_and_mirror(void) {
+    const char *path = "bin/test_book.tmp";
+    uint64_t entries[8];
+    size_t   n = 0;
+
+    // Ply-1 book with made-up scores for B to move: the center is best
+    // for A (B scores -2 there), then columns 2/6; 3/5 draw, 1/7 lose.
+    static const int first_move_score_for_b[COLS] = { 1, -1, 0, -2, 0, -1, 1 };
+    Board root; board_init(&root);
+    entries[n++] = book_entry(book_key(&root, CELL_A), 2);
+    for (int col = 1; col <= 4; col++) {
+        Board b; board_init(&b);
+        assert(drop(&b, col, CELL_A, NULL, NULL));
+        entries[n++] = book_entry(book_key(&b, CELL_B), first_move_score_for_b[col - 1]);
+    }
+    assert(book_write(path, 1, entries, n) == 0);
+
+    OpeningBook bk;
+    assert(book_open(&bk, path) == 0);
+    assert(bk.count == n && bk.max_ply == 1);
+
+    int score, col;
+    Board b; board_init(&b);
+    assert(book_probe(&bk, &b, CELL_A, &score) && score == 2);
+    assert(book_best_move(&bk, &b, CELL_A, &col, &score));
+    assert(col == 4 && score == 2);
+
+    // Mirror positions share an entry: column 6 reads column 2's score.
+    assert(drop(&b, 6, CELL_A, NULL, NULL));
+    assert(book_probe(&bk, &b, CELL_B, &score) && score == -1);
+    assert(!book_best_move(&bk, &b, CELL_B, &col, &score));  // beyond max_ply
+
+    book_close(&bk);
+
+    // A count that only matches the size after wrapping is rejected,
+    // and so is a trailing partial entry.
+    FILE *f = fopen(path, "r+b");
+    assert(f);
+    uint64_t bad = n + ((uint64_t)1 << 61);
+    assert(fseek(f, offsetof(BookHeader, count), SEEK_SET) == 0);
+    assert(fwrite(&bad, sizeof(bad), 1, f) == 1);
+    fclose(f);
+    assert(book_open(&bk, path) == -1);
+
+    assert(book_write(path, 1, entries, n) == 0);
+    f = fopen(path, "ab");
+    assert(f);
+    assert(fputc(0, f) == 0);
+    fclose(f);
+    assert(book_open(&bk, path) == -1);
+
+    remove(path);
+    assert(book_open(&bk, path) == -1);
+}
+
+static void test_zobrist_keys_incremental_and_mirror(void) {
+    Board b;  board_init(&b);
+    Board m;  board_init(&m);
+    uint64_t key = 0;    // kept incrementally, as the search does
+    uint64_t full, mirror, mkey, mmirror;
+
+    // Random game: the incremental key matches a full recompute, and
+    // the mirrored game has the swapped keys.
+    srand(7);
+    Cell p = CELL_A;
+    while (!board_is_full(&b)) {
+        int col = 1 + rand() % COLS;
+        int r;
+        if (!board_drop(&b, col, p, &r)) continue;
+        assert(board_drop(&m, COLS + 1 - col, p, NULL));
+        key ^= board_last_zobrist(&b);
+
+        board_compute_keys(&b, &full, &mirror);
+        board_compute_keys(&m, &mkey, &mmirror);
+        assert(key == full);
+        assert(mkey == mirror && mmirror == full);
+        assert(board_canonical_key(&m) == board_canonical_key(&b));
+        p = (p == CELL_A) ? CELL_B : CELL_A;
+    }
+
+    // Transposition: same pieces in another order, same key.
+    Board t1; board_init(&t1);
+    Board t2; board_init(&t2);
+    assert(board_play_sequence(&t1, "1234") == 4);
+    assert(board_play_sequence(&t2, "3214") == 4);
+    assert(board_canonical_key(&t1) == board_canonical_key(&t2));
+    assert(board_play_sequence(&t2, "1") == 1);
+    assert(board_canonical_key(&t1) != board_canonical_key(&t2));
+
+    // Undo restores the key all the way back.
+    while (b.moves > 0) {
+        key ^= board_last_zobrist(&b);
+        board_undo(&b, NULL);
+    }
+    assert(key == 0);
+}
+
+static void test_incremental_eval_matches_scan(void) {
+    srand(11);
+    for (int game = 0; game < 50; game++) {
+        Board     b; board_init(&b);
+        EvalState e; eval_state_init(&e, &b);
+        Cell p = CELL_A;
+
+        while (!board_is_full(&b)) {
+            int col = 1 + rand() % COLS;
+            if (!board_drop(&b, col, p, NULL)) continue;
+            eval_state_push(&e, &b);
+            assert(eval_state_score(&e, CELL_A) == evaluate_board_scan(&b, CELL_A));
+            assert(eval_state_score(&e, CELL_B) == evaluate_board_scan(&b, CELL_B));
+            p = (p == CELL_A) ? CELL_B : CELL_A;
+
+            // A state built from scratch agrees with the running one.
+            EvalState fresh;
+            eval_state_init(&fresh, &b);
+            assert(memcmp(fresh.window_count, e.window_count, sizeof(e.window_count)) == 0);
+            assert(fresh.score[0] == e.score[0] && fresh.score[1] == e.score[1]);
+        }
+        while (b.moves > 0) {
+            eval_state_pop(&e, &b);
+            board_undo(&b, NULL);
+            assert(eval_state_score(&e, CELL_A) == evaluate_board_scan(&b, CELL_A));
+            assert(eval_state_score(&e, CELL_B) == evaluate_board_scan(&b, CELL_B));
+        }
+        assert(e.score[0] == 0 && e.score[1] == 0);
+    }
+}
+
+static void test_eval_scan_kernels_match_reference(void) {
+    static const char *kernels[] = { "scalar", "avx2" };
+
+    srand(13);
+    for (int game = 0; game < 200; game++) {
+        Board b; board_init(&b);
+        Cell p = CELL_A;
+        int  plies = rand() % (ROWS * COLS + 1);
+
+        while (b.moves < plies) {
+            if (board_drop(&b, 1 + rand() % COLS, p, NULL)) {
+                p = (p == CELL_A) ? CELL_B : CELL_A;
+            }
+        }
+
+        for (int me = 0; me < 2; me++) {
+            Cell who = me ? CELL_B : CELL_A;
+            int  ref = evaluate_board_reference(&b, who);
+            assert(evaluate_board_scan(&b, who) == ref);
+            assert(evaluate_board(&b, who) == ref);
+
+            for (int k = 0; k < 2; k++) {
+                EvalCountFn fn = eval_count_kernel(kernels[k]);
+                if (!fn) continue;  // CPU lacks this kernel
+                EvalCounts counts;
+                Bitboard   center = board_column_mask(COLS / 2);
+                fn(b.stones[0], b.stones[1], &counts);
+                assert(eval_score_counts(&counts, b.stones[me] & center,
+                                         b.stones[me ^ 1] & center, me) == ref);
+            }
+        }
+    }
+}
+
+static uint8_t winning_columns(const Board *b, Cell p) {
+    uint8_t cols = 0;
+    for (int c = 0; c < COLS; c++) {
+        Board t = *b;
+        int   r;
+        if (board_drop(&t, c + 1, p, &r) && board_is_winning(&t, r, c, p)) {
+            cols |= (uint8_t)(1u << c);
+        }
+    }
+    return cols;
+}
+
+static void test_batch_matches_single_position(void) {
+    // 203 positions: not a multiple of four, so the scalar tail runs too.
+    enum { N = 203 };
+    static Board boards[N];
+    PositionBatch pb;
+    assert(batch_init(&pb, N) == 0);
+
+    srand(17);
+    for (int i = 0; i < N; i++) {
+        Board *b = &boards[i];
+        board_init(b);
+        Cell p     = CELL_A;
+        int  plies = rand() % (ROWS * COLS + 1);
+        while (b->moves < plies) {
+            if (board_drop(b, 1 + rand() % COLS, p, NULL)) {
+                p = (p == CELL_A) ? CELL_B : CELL_A;
+            }
+        }
+        assert(batch_push(&pb, b));
+    }
+    assert(!batch_push(&pb, &boards[0]));
+
+    batch_run(&pb);
+
+    for (int i = 0; i < N; i++) {
+        const Board *b = &boards[i];
+        uint8_t legal = 0;
+        for (int c = 0; c < COLS; c++) {
+            if (board_height(b, c) < ROWS) legal |= (uint8_t)(1u << c);
+        }
+        assert(pb.eval_a[i] == evaluate_board(b, CELL_A));
+        assert(pb.eval_b[i] == evaluate_board(b, CELL_B));
+        assert(pb.legal[i] == legal);
+        assert(pb.win_a[i] == winning_columns(b, CELL_A));
+        assert(pb.win_b[i] == winning_columns(b, CELL_B));
+    }
+
+    batch_free(&pb);
+}
+
+// Pool test task: sums 1..n, splitting ranges into subtasks that it
+// submits and waits on from inside the pool.
+typedef struct {
+    ThreadPool *pool;
+    int         lo, hi;
+    long        sum;
+} SumTask;
+
+static void sum_task_main(void *arg) {
+    SumTask *t = (SumTask*)arg;
+    if (t->hi - t->lo <= 8) {
+        t->sum = 0;
+        for (int i = t->lo; i <= t->hi; i++) t->sum += i;
+        return;
+    }
+    int mid = t->lo + (t->hi - t->lo) / 2;
+    SumTask  left  = { t->pool, t->lo, mid, 0 };
+    SumTask  right = { t->pool, mid + 1, t->hi, 0 };
+    PoolTask lt, rt;
+    pool_submit(t->pool, &lt, sum_task_main, &left);
+    pool_submit(t->pool, &rt, sum_task_main, &right);
+    pool_wait(t->pool, &rt);
+    pool_wait(t->pool, &lt);
+    t->sum = left.sum + right.sum;
+}
+
+static void test_threat_map_matches_cell_scan(void) {
+    // On random positions, each player's playable threats are exactly
+    // the columns whose landing cell board_is_winning() accepts.
+    srand(15);
+    for (int g = 0; g < 200; g++) {
+        Board b; board_init(&b);
+        Cell  p = CELL_A;
+        int   plies = rand() % (ROWS * COLS);
+        while (b.moves < plies) {
+            if (board_drop(&b, 1 + rand() % COLS, p, NULL)) {
+                p = (p == CELL_A) ? CELL_B : CELL_A;
+            }
+        }
+
+        ThreatMap tm;
+        board_threat_map(&b, &tm);
+        for (int c = 0; c < COLS; c++) {
+            int  h    = board_height(&b, c);
+            bool open = h < ROWS;
+            assert(((tm.playable & board_column_mask(c)) != 0) == open);
+            for (int who = 0; who < 2; who++) {
+                Cell piece = who ? CELL_B : CELL_A;
+                bool win   = open && board_is_winning(&b, ROWS - 1 - h, c, piece);
+                assert(((tm.now[board_player_index(piece)] & board_column_mask(c)) != 0) == win);
+            }
+        }
+    }
+}
+
+static void test_mcts_tactics_and_tree_reuse(void) {
+    MctsLimits limits = { 20000, 0, 1, NULL, NULL, false };
+    MctsResult res;
+
+    // A has three in row 6 (cols 1-3): A takes the win, B must block.
+    Board b; board_init(&b);
+    assert(board_play_sequence(&b, "11223") == 5);
+    mcts_new_game();
+    assert(mcts_best_move(&b, CELL_A, &limits, &res) == 4);
+    assert(res.playouts >= limits.playouts && res.reused == 0);
+    assert(res.nodes > 0 && res.memory_bytes <= res.arena_bytes);
+
+    mcts_new_game();
+    assert(mcts_best_move(&b, CELL_B, &limits, &res) == 4);
+
+    // Tree reuse: after our move and a reply, the old subtree is kept.
+    Board g; board_init(&g);
+    mcts_new_game();
+    int col = mcts_best_move(&g, CELL_A, &limits, &res);
+    assert(col >= 1 && col <= COLS);
+    assert(board_drop(&g, col, CELL_A, NULL));
+    assert(board_drop(&g, col, CELL_B, NULL));
+    mcts_best_move(&g, CELL_A, &limits, &res);
+    assert(res.reused > 0);
+
+    // An unrelated position starts from scratch.
+    Board h; board_init(&h);
+    assert(board_play_sequence(&h, "7777") == 4);
+    mcts_best_move(&h, CELL_A, &limits, &res);
+    assert(res.reused == 0);
+    mcts_new_game();
+}
+
+static double wall_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/* Ponder until the answer to 'col' was solved, restarting every 20 ms
+   (the solver table keeps earlier solves); fails after 10 s. */
+static void ponder_until_solved(const Board *b, Cell to_move, Cell engine, int col,
+                                PonderReport *rep) {
+    double deadline = wall_ms() + 10000;
+    do {
+        ponder_start(b, to_move, engine, BOT_PERFECT);
+        sleep_ms(20);
+        ponder_stop(col, rep);
+        assert(rep->ran);
+    } while (!rep->hit_solved && wall_ms() < deadline);
+    assert(rep->hit_solved);
+}
+
+/* Wait (up to 10 s) until the search table holds an entry of depth
+   >= 1 for 'engine' to move in b, as a running ponder leaves. */
+static void wait_for_search_entry(const Board *b, Cell engine) {
+    uint64_t key;   // the search's key: side and view folded in
+    board_compute_keys(b, &key, NULL);
+    if (engine == CELL_B) key ^= board_zobrist(2, 0) ^ board_zobrist(2, 1);
+
+    double  deadline = wall_ms() + 10000;
+    TTEntry e;
+    TTStats tts = {0, 0, 0};
+    while (!(tt_probe(search_tt(), key, &e, &tts) && e.depth >= 1)) {
+        assert(wall_ms() < deadline);
+        sleep_ms(5);
+    }
+}
+
+static void test_ponder_cancels_and_saves_work(void) {
+    PonderReport rep;
+
+    // Rule-based levels do not ponder.
+    Board b; board_init(&b);
+    ponder_start(&b, CELL_A, CELL_B, BOT_MEDIUM);
+    ponder_stop(4, &rep);
+    assert(!rep.ran);
+
+    // Alpha-beta: the answer to the likeliest reply gets searched, all
+    // in one table generation.
+    search_new_game();
+    uint8_t gen = atomic_load(&search_tt()->generation);
+    ponder_start(&b, CELL_A, CELL_B, BOT_HARD);
+    Board reply = b;
+    assert(board_drop(&reply, 4, CELL_A, NULL));
+    wait_for_search_entry(&reply, CELL_B);
+    // The ponder has no budget, so ponder_stop() only returns once the
+    // task saw the cancel flag; it is then released and reports once.
+    ponder_stop(4, &rep);
+    assert(rep.ran && rep.work > 0 && rep.played_col == 4);
+    assert(rep.hit_depth >= 1 && rep.hit_depth < ROWS * COLS);
+    PonderReport again;
+    ponder_stop(4, &again);
+    assert(!again.ran);
+    assert(atomic_load(&search_tt()->generation) == (uint8_t)(gen + 1));
+
+    // MCTS: the reply is a child of the pondered root, so the next
+    // search starts from the pondered playouts.
+    // Its playouts only show once it stops; the kept tree grows across
+    // restarts.
+    mcts_new_game();
+    double deadline = wall_ms() + 10000;
+    do {
+        ponder_start(&b, CELL_A, CELL_B, BOT_MCTS);
+        sleep_ms(20);
+        ponder_stop(4, &rep);
+        assert(rep.ran);
+    } while (rep.work == 0 && wall_ms() < deadline);
+    assert(rep.work > 0);
+
+    // The ponder's search is not reported as the last move's.
+    MctsResult res;
+    assert(!mcts_last_result(&res));
+
+    MctsLimits limits = { 1000, 0, 1, NULL, NULL, false };
+    assert(board_drop(&b, 4, CELL_A, NULL));
+    mcts_best_move(&b, CELL_B, &limits, &res);
+    assert(res.reused > 0);
+    MctsResult last;
+    assert(mcts_last_result(&last) && last.playouts == res.playouts);
+    mcts_new_game();
+
+    // Perfect level: the answers are solved into the solver table.
+    Board m; board_init(&m);
+    assert(board_play_sequence(&m, "336641141437755743") == 18);
+    solver_reset();
+    ponder_until_solved(&m, CELL_A, CELL_B, 4, &rep);
+    assert(rep.diff == BOT_PERFECT && rep.work > 0);
+}
+
+static void test_bot_search_async_stop_and_progress(void) {
+    Board b; board_init(&b);
+    assert(board_play_sequence(&b, "4453432") == 7);
+
+    // Stopping a hard search returns its last completed iteration,
+    // which is also the last progress published.
+    BotSearch s;
+    bot_search_start(&s, &b, BOT_HARD, CELL_B);
+    double deadline = wall_ms() + 10000;
+    while (atomic_load(&s.progress.updates) == 0) {
+        assert(wall_ms() < deadline);
+        sleep_ms(5);
+    }
+    bot_search_stop(&s);
+    double t0 = wall_ms();
+    int col = bot_search_wait(&s);
+    assert(wall_ms() - t0 < 100);
+    assert(bot_search_poll(&s));
+    assert(col >= 1 && col <= COLS);
+    assert(atomic_load(&s.progress.updates) > 0);
+    assert(atomic_load(&s.progress.depth) >= 1);
+    assert(atomic_load(&s.progress.best_col) == col);
+
+    // Levels that do not search publish their move once.
+    bot_search_start(&s, &b, BOT_EASY, CELL_B);
+    col = bot_search_wait(&s);
+    assert(col == bot_pick_easy_plus(&b, CELL_B));
+    assert(atomic_load(&s.progress.best_col) == col);
+}
+
+static void test_ranking_keeps_searched_root_entry(void) {
+    // A searched root entry (as a ponder leaves) survives a ranking of
+    // the same position. A is to move, so the search key is the
+    // position's Zobrist key.
+    Board b; board_init(&b);
+    assert(board_play_sequence(&b, "445343") == 6);
+    uint64_t key;
+    board_compute_keys(&b, &key, NULL);
+
+    SearchLimits limits = { 8, 0, 0, 1, NULL, NULL, false, false };
+    TTStats      tts    = {0, 0, 0};
+    TTEntry      before, after;
+    search_new_game();
+    search_best_move(&b, CELL_A, &limits, NULL);
+    assert(tt_probe(search_tt(), key, &before, &tts) && before.depth > 0);
+
+    limits.max_depth = 4;
+    search_rank_columns(&b, CELL_A, &limits, NULL);
+    assert(tt_probe(search_tt(), key, &after, &tts));
+    assert(after.depth == before.depth && after.bound == before.bound &&
+           after.score == before.score);
+    search_new_game();
+}
+
+static void test_column_ranking_and_cache(void) {
+    // Column 1 is full; A wins at once in 3 or 7 and in three plies
+    // anywhere else, since B cannot block both.
+    Board b; board_init(&b);
+    assert(board_play_sequence(&b, "111111445566") == 12);
+
+    SearchLimits  limits = { 6, 0, 0, 1, NULL, NULL, false, false };
+    SearchRanking sr;
+    assert(search_rank_columns(&b, CELL_A, &limits, &sr) == 3);
+    assert(sr.col_score[0] == SEARCH_NO_SCORE);
+    assert(sr.col_plies[2] == 1 && sr.col_plies[6] == 1);
+    assert(sr.col_score[2] > sr.col_score[1]);
+    for (int c = 1; c < COLS; c++) {
+        assert(sr.col_score[c] > WIN_SCORE / 2);
+        assert(sr.col_plies[c] == ((c == 2 || c == 6) ? 1 : 3));
+    }
+
+    // The bot's ranking is exact here and agrees on the distances.
+    ColumnRanking r;
+    assert(bot_rank_columns(&b, CELL_A, &r) == 3);
+    assert(r.exact && !r.cached);
+    assert(r.col_score[0] == BOT_NO_SCORE);
+    for (int c = 1; c < COLS; c++) {
+        assert(r.col_score[c] > 0);
+        assert(r.col_plies[c] == sr.col_plies[c]);
+    }
+
+    // Asking again, or for the mirror image, hits the cache.
+    ColumnRanking again;
+    assert(bot_rank_columns(&b, CELL_A, &again) == 3);
+    assert(again.cached);
+
+    Board m; board_init(&m);
+    assert(board_play_sequence(&m, "777777443322") == 12);
+    assert(bot_rank_columns(&m, CELL_A, &again) == 5);
+    assert(again.cached && again.exact);
+    for (int c = 0; c < COLS; c++) {
+        assert(again.col_score[c] == r.col_score[COLS - 1 - c]);
+        assert(again.col_plies[c] == r.col_plies[COLS - 1 - c]);
+    }
+
+    // The bot plays from the cached ranking.
+    assert(bot_pick_perfect(&m, CELL_A) == 5);
+}
+
+static void test_pool_nested_tasks(void) {
+    // Two workers and deep nesting: waiting tasks must help, not block.
+    ThreadPool pool;
+    assert(pool_init(&pool, 2) == 0);
+
+    SumTask  root = { &pool, 1, 1000, 0 };
+    PoolTask task;
+    pool_submit(&pool, &task, sum_task_main, &root);
+    pool_wait(&pool, &task);
+    assert(pool_done(&task));
+    assert(root.sum == 1000L * 1001 / 2);
+
+    pool_destroy(&pool);
+}
+
+typedef struct {
+    ThreadPool *pool;
+    PoolTask   *task;
+    atomic_bool flag;    // blocker: started; others: ran
+    atomic_bool release; // blocker only
+} FlagTask;
+
+static void flag_task_main(void *arg) {
+    FlagTask *f = (FlagTask*)arg;
+    atomic_store(&f->flag, true);
+    // The blocker (task left NULL) holds its worker until released.
+    while (f->task == NULL && !atomic_load(&f->release)) {
+        sleep_ms(1);
+    }
+}
+
+static void *submit_from_thread(void *arg) {
+    FlagTask *f = (FlagTask*)arg;
+    pool_submit(f->pool, f->task, flag_task_main, f);
+    return NULL;
+}
+
+static void test_pool_wait_skips_unrelated_tasks(void) {
+    // The only worker is busy. Waiting on our own task runs it in place,
+    // but never the task another thread queued.
+    ThreadPool pool;
+    assert(pool_init(&pool, 1) == 0);
+
+    PoolTask blocker_task, other_task, own_task;
+    FlagTask blocker = { &pool, NULL, false, false };
+    FlagTask other   = { &pool, &other_task, false, false };
+    FlagTask own     = { &pool, &own_task, false, false };
+
+    pool_submit(&pool, &blocker_task, flag_task_main, &blocker);
+    while (!atomic_load(&blocker.flag)) sleep_ms(1);
+
+    pthread_t th;
+    assert(pthread_create(&th, NULL, submit_from_thread, &other) == 0);
+    pthread_join(th, NULL);
+
+    pool_submit(&pool, &own_task, flag_task_main, &own);
+    pool_wait(&pool, &own_task);
+    assert(atomic_load(&own.flag));
+    assert(!atomic_load(&other.flag) && !pool_done(&other_task));
+
+    atomic_store(&blocker.release, true);
+    pool_wait(&pool, &other_task);
+    assert(atomic_load(&other.flag));
+    pool_wait(&pool, &blocker_task);
+    pool_destroy(&pool);
+}
+
 int main(void) {
     test_vertical_win();
     test_horizontal_win();
     test_diag_slash_win();
+    test_no_wrap_across_columns();
+    test_cells_heights_and_full();
+    test_undo_restores_position();
+    test_tt_store_and_probe();
+    test_solver_concurrent_solves();
+    test_search_finds_forced_win();
+    test_quiescence_follows_forced_moves();
+    test_play_sequence_and_winning_cells();
+    test_solver_matches_brute_force();
+    test_book_roundtrip_and_mirror();
+    test_zobrist_keys_incremental_and_mirror();
+    test_incremental_eval_matches_scan();
+    test_eval_scan_kernels_match_reference();
+    test_batch_matches_single_position();
+    test_threat_map_matches_cell_scan();
+    test_mcts_tactics_and_tree_reuse();
+    test_ponder_cancels_and_saves_work();
+    test_bot_search_async_stop_and_progress();
+    test_column_ranking_and_cache();
+    test_ranking_keeps_searched_root_entry();
+    test_pool_nested_tasks();
+    test_pool_wait_skips_unrelated_tasks();
     puts("All tests passed.");
     return 0;
 }
@@ -0,0 +1,295 @@
+// book_gen.c
+// Build the opening book: enumerate every position with up to N pieces
+// (one per mirror pair), solve the positions with exactly N pieces in
+// parallel with the exact solver, back the scores up to the shallower
+// plies by negamax over the book itself, and write the sorted file.
+//
+// Usage: book_gen [-p PLY] [-j THREADS] [-o FILE]
+#define _XOPEN_SOURCE 700
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "book.h"
+#include "solver.h"
+
+typedef struct {
+    uint64_t key;
+    Board    board;
+    int      score;
+} BookPos;
+
+typedef struct {
+    BookPos *v;
+    size_t   n;
+    size_t   cap;
+} PosList;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static void list_push(PosList *l, const BookPos *p) {
+    if (l->n == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 1024;
+        l->v   = realloc(l->v, l->cap * sizeof(*l->v));
+        if (!l->v) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    l->v[l->n++] = *p;
+}
+
+static int cmp_pos(const void *a, const void *b) {
+    uint64_t x = ((const BookPos*)a)->key;
+    uint64_t y = ((const BookPos*)b)->key;
+    return (x > y) - (x < y);
+}
+
+/* Sort by key and drop duplicates. */
+static void list_unique(PosList *l) {
+    qsort(l->v, l->n, sizeof(*l->v), cmp_pos);
+    size_t w = 0;
+    for (size_t i = 0; i < l->n; i++) {
+        if (w == 0 || l->v[i].key != l->v[w - 1].key) {
+            l->v[w++] = l->v[i];
+        }
+    }
+    l->n = w;
+}
+
+static const BookPos *list_find(const PosList *l, uint64_t key) {
+    size_t lo = 0, hi = l->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (l->v[mid].key < key)      lo = mid + 1;
+        else if (l->v[mid].key > key) hi = mid;
+        else return &l->v[mid];
+    }
+    return NULL;
+}
+
+static Cell to_move_at(int ply) {
+    return (ply % 2 == 0) ? CELL_A : CELL_B;
+}
+
+/* Children of every position in 'from' that do not end the game. */
+static void expand(const PosList *from, int ply, PosList *to) {
+    Cell turn = to_move_at(ply);
+    Cell next = to_move_at(ply + 1);
+
+    for (size_t i = 0; i < from->n; i++) {
+        Board b = from->v[i].board;
+        for (int col = 1; col <= COLS; col++) {
+            int r;
+            if (!board_drop(&b, col, turn, &r)) continue;
+            if (!board_is_winning(&b, r, col - 1, turn) && !board_is_full(&b)) {
+                BookPos p;
+                p.key   = book_key(&b, next);
+                p.board = b;
+                p.score = 0;
+                list_push(to, &p);
+            }
+            board_undo(&b, NULL);
+        }
+    }
+    list_unique(to);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Parallel leaf solving                                                     */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    PosList        *leaves;
+    int             ply;
+    _Atomic size_t  next;
+    _Atomic size_t  done;
+} SolveJob;
+
+static void* solve_worker(void *arg) {
+    SolveJob *job = (SolveJob*)arg;
+    Cell turn = to_move_at(job->ply);
+
+    while (1) {
+        size_t i = atomic_fetch_add(&job->next, 1);
+        if (i >= job->leaves->n) break;
+
+        BookPos *p = &job->leaves->v[i];
+        solver_score(&p->board, turn, NULL, &p->score, NULL);
+        atomic_fetch_add(&job->done, 1);
+    }
+    return NULL;
+}
+
+static void solve_leaves(PosList *leaves, int ply, int threads) {
+    SolveJob job;
+    job.leaves = leaves;
+    job.ply    = ply;
+    atomic_init(&job.next, 0);
+    atomic_init(&job.done, 0);
+
+    /* One table generation for the whole run; the solves never age it. */
+    solver_new_game();
+
+    pthread_t *tids = calloc((size_t)threads, sizeof(*tids));
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&tids[started], NULL, solve_worker, &job) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        solve_worker(&job);
+    }
+
+    double start = now_ms();
+    while (atomic_load(&job.done) < leaves->n && started > 0) {
+        sleep(5);
+        size_t done = atomic_load(&job.done);
+        double secs = (now_ms() - start) / 1000.0;
+        fprintf(stderr, "  solved %zu/%zu (%.0f s, %.1f positions/s)\n",
+                done, leaves->n, secs, secs > 0 ? done / secs : 0.0);
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    free(tids);
+}
+
+/* Negamax one ply up using the (already scored) deeper level. */
+static void back_up(PosList *level, int ply, const PosList *deeper) {
+    Cell turn = to_move_at(ply);
+    Cell next = to_move_at(ply + 1);
+
+    for (size_t i = 0; i < level->n; i++) {
+        Board b     = level->v[i].board;
+        int   best  = -ROWS * COLS;
+        int   moves = __builtin_popcountll(board_mask(&b));
+
+        for (int col = 1; col <= COLS; col++) {
+            int r, score;
+            if (!board_drop(&b, col, turn, &r)) continue;
+
+            if (board_is_winning(&b, r, col - 1, turn)) {
+                score = (ROWS * COLS + 1 - moves) / 2;
+            } else if (board_is_full(&b)) {
+                score = 0;
+            } else {
+                /* expand() put every child in the deeper level. */
+                const BookPos *child = list_find(deeper, book_key(&b, next));
+                if (!child) {
+                    fprintf(stderr, "book_gen: ply %d child missing from ply %d\n",
+                            ply, ply + 1);
+                    exit(1);
+                }
+                score = -child->score;
+            }
+            board_undo(&b, NULL);
+
+            if (score > best) best = score;
+        }
+        level->v[i].score = best;
+    }
+}
+
+int main(int argc, char **argv) {
+    int         max_ply = 6;
+    int         threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *path    = BOOK_DEFAULT_PATH;
+    int         opt;
+
+    while ((opt = getopt(argc, argv, "p:j:o:")) != -1) {
+        switch (opt) {
+            case 'p': max_ply = atoi(optarg); break;
+            case 'j': threads = atoi(optarg); break;
+            case 'o': path    = optarg;       break;
+            default:
+                fprintf(stderr, "usage: %s [-p PLY] [-j THREADS] [-o FILE]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (max_ply < 1 || max_ply > ROWS * COLS - 1 || threads < 1) {
+        fprintf(stderr, "book_gen: need 1 <= PLY < %d and THREADS >= 1\n", ROWS * COLS);
+        return 2;
+    }
+
+    double   start  = now_ms();
+    PosList *levels = calloc((size_t)max_ply + 1, sizeof(*levels));
+
+    BookPos root;
+    board_init(&root.board);
+    root.key   = book_key(&root.board, CELL_A);
+    root.score = 0;
+    list_push(&levels[0], &root);
+
+    for (int ply = 0; ply < max_ply; ply++) {
+        expand(&levels[ply], ply, &levels[ply + 1]);
+        fprintf(stderr, "ply %d: %zu positions\n", ply + 1, levels[ply + 1].n);
+    }
+
+    fprintf(stderr, "solving %zu positions at ply %d on %d threads\n",
+            levels[max_ply].n, max_ply, threads);
+    solve_leaves(&levels[max_ply], max_ply, threads);
+
+    for (int ply = max_ply - 1; ply >= 0; ply--) {
+        back_up(&levels[ply], ply, &levels[ply + 1]);
+    }
+
+    size_t total = 0;
+    for (int ply = 0; ply <= max_ply; ply++) total += levels[ply].n;
+
+    uint64_t *entries = malloc(total * sizeof(*entries));
+    size_t    n       = 0;
+    for (int ply = 0; ply <= max_ply; ply++) {
+        for (size_t i = 0; i < levels[ply].n; i++) {
+            entries[n++] = book_entry(levels[ply].v[i].key, levels[ply].v[i].score);
+        }
+    }
+
+    if (book_write(path, max_ply, entries, n) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    /* Reopen through mmap and time a probe of every stored position. */
+    OpeningBook bk;
+    if (book_open(&bk, path) != 0) {
+        fprintf(stderr, "book_gen: cannot reopen %s\n", path);
+        return 1;
+    }
+
+    double   t0     = now_ms();
+    size_t   probes = 0;
+    int      bad    = 0;
+    for (int ply = 0; ply <= max_ply; ply++) {
+        for (size_t i = 0; i < levels[ply].n; i++) {
+            int score;
+            if (!book_probe(&bk, &levels[ply].v[i].board, to_move_at(ply), &score) ||
+                score != levels[ply].v[i].score) {
+                bad++;
+            }
+            probes++;
+        }
+    }
+    double probe_ns = probes ? (now_ms() - t0) * 1e6 / (double)probes : 0.0;
+
+    printf("%s: %zu positions (ply <= %d), %zu bytes, root score %+d, "
+           "%.0f ns/probe, built in %.1f s%s\n",
+           path, bk.count, max_ply, bk.map_len, levels[0].v[0].score,
+           probe_ns, (now_ms() - start) / 1000.0, bad ? " (PROBE MISMATCH)" : "");
+
+    book_close(&bk);
+    for (int ply = 0; ply <= max_ply; ply++) free(levels[ply].v);
+    free(levels);
+    free(entries);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,561 @@
+// perft.c
+// Move-generation check and board-layer stress test. From a start
+// position, count every move sequence of each length up to DEPTH (a
+// winning move ends its sequence), splitting the tree into subtrees run
+// on the thread pool. Then count the distinct positions of each ply,
+// breadth-first with a deduplicating hash set of position keys; when the
+// set outgrows its memory budget it spills sorted runs to temporary
+// files, merged at the end of the ply. Prints both counts per ply with
+// their throughput and, from the empty board, checks them against the
+// published counts.
+//
+// Usage: perft [-d DEPTH] [-p MOVES] [-j THREADS] [-m MB] [-T DIR] [-s | -u]
+//   -d DEPTH    plies to count (default 9)
+//   -p MOVES    start from this 1-based column sequence (default: empty)
+//   -j THREADS  pool workers (default: online CPUs)
+//   -m MB       hash set memory before spilling to disk (default 256)
+//   -T DIR      directory for spill files (default $TMPDIR or /tmp)
+//   -s          move sequences only
+//   -u          distinct positions only (they grow far slower than
+//               sequences, so this reaches deeper plies)
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "board.h"
+#include "pool.h"
+
+#define MAX_PLY    (ROWS * COLS)
+#define SPLIT_PLY  3                // subtrees start this many plies down
+#define CHUNK_KEYS 4096             // frontier positions per expansion task
+
+/*
+ * Position key: A's stones plus the occupied cells plus the bottom row.
+ * Per column that is A's stones below a marker bit on the first empty
+ * cell, so the key is unique and decodes back to the position. Bit 63
+ * marks positions that end the game with a win; they are counted but
+ * not expanded.
+ */
+#define KEY_TERMINAL (((uint64_t)1) << 63)
+
+static uint64_t position_key(const Board *b) {
+    return b->stones[0] + board_mask(b) + BOARD_BOTTOM_MASK;
+}
+
+static void position_from_key(uint64_t key, Board *b) {
+    board_init(b);
+    for (int c = 0; c < COLS; c++) {
+        unsigned col = (unsigned)(key >> (c * BOARD_H1)) & ((1u << BOARD_H1) - 1);
+        int      h   = 31 - __builtin_clz(col);
+
+        for (int r = 0; r < h; r++) {
+            board_drop(b, c + 1, ((col >> r) & 1) ? CELL_A : CELL_B, NULL);
+        }
+    }
+}
+
+static Cell side_to_move(const Board *b) {
+    return (b->moves % 2 == 0) ? CELL_A : CELL_B;
+}
+
+static Cell other(Cell p) {
+    return (p == CELL_A) ? CELL_B : CELL_A;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/*
+ * Counts from the empty board. Distinct positions per ply are OEIS
+ * A212693. Sequences are 7^n until ply 7, where seven pieces no longer
+ * fit in one column and the first wins end games.
+ */
+static const uint64_t KNOWN_DISTINCT[] = {
+    1, 7, 49, 238, 1120, 4263, 16422, 54859, 184275, 558186, 1662623,
+    4568683, 12236101, 30929111, 75437595, 176541259, 394591391,
+};
+
+static const uint64_t KNOWN_SEQUENCES[] = {
+    1, 7, 49, 343, 2401, 16807, 117649, 823536, 5673234,
+};
+
+#define KNOWN_COUNT(t) ((int)(sizeof(t) / sizeof((t)[0])))
+
+/* ------------------------------------------------------------------------- */
+/* Move sequences                                                            */
+/* ------------------------------------------------------------------------- */
+
+typedef struct {
+    Board    board;
+    int      ply;                   // plies below the start position
+    int      depth;
+    uint64_t counts[MAX_PLY + 1];   // sequences ending at each ply
+    PoolTask task;
+} Subtree;
+
+static void perft(Board *b, Cell p, int ply, int depth, uint64_t *counts) {
+    for (int c = 1; c <= COLS; c++) {
+        int row;
+        if (!board_drop(b, c, p, &row)) continue;
+
+        counts[ply + 1]++;
+        if (ply + 1 < depth && !board_is_winning(b, row, c - 1, p)) {
+            perft(b, other(p), ply + 1, depth, counts);
+        }
+        board_undo(b, NULL);
+    }
+}
+
+static void subtree_main(void *arg) {
+    Subtree *s = (Subtree*)arg;
+    perft(&s->board, side_to_move(&s->board), s->ply, s->depth, s->counts);
+}
+
+/* Collect the open positions SPLIT_PLY plies down, counting the plies above. */
+static void collect_subtrees(Board *b, Cell p, int ply, int depth, uint64_t *counts,
+                             Subtree **list, size_t *n, size_t *cap) {
+    if (ply == depth) {
+        return;
+    }
+    if (ply == SPLIT_PLY) {
+        if (*n == *cap) {
+            *cap  = *cap ? *cap * 2 : 64;
+            *list = realloc(*list, *cap * sizeof(**list));
+            if (!*list) {
+                fprintf(stderr, "perft: out of memory\n");
+                exit(1);
+            }
+        }
+        Subtree *s = &(*list)[(*n)++];
+        memset(s, 0, sizeof(*s));
+        s->board = *b;
+        s->ply   = ply;
+        s->depth = depth;
+        return;
+    }
+
+    for (int c = 1; c <= COLS; c++) {
+        int row;
+        if (!board_drop(b, c, p, &row)) continue;
+
+        counts[ply + 1]++;
+        if (!board_is_winning(b, row, c - 1, p)) {
+            collect_subtrees(b, other(p), ply + 1, depth, counts, list, n, cap);
+        }
+        board_undo(b, NULL);
+    }
+}
+
+static void count_sequences(const Board *start, int depth, ThreadPool *pool,
+                            uint64_t *counts) {
+    Subtree *list = NULL;
+    size_t   n    = 0;
+    size_t   cap  = 0;
+    Board    b    = *start;
+
+    counts[0] = 1;
+    collect_subtrees(&b, side_to_move(&b), 0, depth, counts, &list, &n, &cap);
+
+    for (size_t i = 0; i < n; i++) {
+        pool_submit(pool, &list[i].task, subtree_main, &list[i]);
+    }
+    for (size_t i = 0; i < n; i++) {
+        pool_wait(pool, &list[i].task);
+        for (int ply = list[i].ply + 1; ply <= depth; ply++) {
+            counts[ply] += list[i].counts[ply];
+        }
+    }
+    free(list);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Distinct positions                                                        */
+/* ------------------------------------------------------------------------- */
+
+static const char *g_tmp_dir = NULL;
+
+/* An anonymous temporary file in g_tmp_dir, removed when closed. */
+static FILE *spill_file(void) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/connect4-perft-XXXXXX", g_tmp_dir);
+
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    unlink(path);
+
+    FILE *f = fdopen(fd, "w+b");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    return f;
+}
+
+/*
+ * Open-addressing set of nonzero keys. At half full its keys are
+ * sorted and written out as a run, and the set starts over empty.
+ */
+typedef struct {
+    uint64_t *slots;
+    size_t    mask;       // slot count - 1 (a power of two)
+    size_t    n;
+    FILE    **runs;
+    size_t    run_count;
+    size_t    run_cap;
+    uint64_t  spilled;    // keys written to runs, duplicates included
+} KeySet;
+
+static int keyset_init(KeySet *s, size_t bytes) {
+    size_t slots = 1024;
+    while (slots * 2 * sizeof(uint64_t) <= bytes) {
+        slots *= 2;
+    }
+    memset(s, 0, sizeof(*s));
+    s->slots = calloc(slots, sizeof(uint64_t));
+    s->mask  = slots - 1;
+    return s->slots ? 0 : -1;
+}
+
+static int cmp_key(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void keyset_spill(KeySet *s) {
+    size_t n = 0;
+    for (size_t i = 0; i <= s->mask; i++) {
+        if (s->slots[i]) {
+            s->slots[n++] = s->slots[i];
+        }
+    }
+    qsort(s->slots, n, sizeof(uint64_t), cmp_key);
+
+    if (s->run_count == s->run_cap) {
+        s->run_cap = s->run_cap ? s->run_cap * 2 : 16;
+        s->runs    = realloc(s->runs, s->run_cap * sizeof(*s->runs));
+        if (!s->runs) {
+            fprintf(stderr, "perft: out of memory\n");
+            exit(1);
+        }
+    }
+    FILE *f = spill_file();
+    if (fwrite(s->slots, sizeof(uint64_t), n, f) != n) {
+        perror("perft: spill");
+        exit(1);
+    }
+    rewind(f);
+    s->runs[s->run_count++] = f;
+    s->spilled += n;
+
+    memset(s->slots, 0, (s->mask + 1) * sizeof(uint64_t));
+    s->n = 0;
+}
+
+static void keyset_insert(KeySet *s, uint64_t key) {
+    size_t i = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 20) & s->mask;
+    while (s->slots[i]) {
+        if (s->slots[i] == key) {
+            return;
+        }
+        i = (i + 1) & s->mask;
+    }
+    s->slots[i] = key;
+    if (++s->n > (s->mask + 1) / 2) {
+        keyset_spill(s);
+    }
+}
+
+/*
+ * Write the distinct keys inserted since the last call to out, merging
+ * the spilled runs if there are any, and empty the set. Returns the count.
+ */
+static uint64_t keyset_drain(KeySet *s, FILE *out) {
+    uint64_t count = 0;
+
+    if (s->run_count == 0) {
+        for (size_t i = 0; i <= s->mask; i++) {
+            if (s->slots[i]) {
+                fwrite(&s->slots[i], sizeof(uint64_t), 1, out);
+                s->slots[i] = 0;
+                count++;
+            }
+        }
+        s->n = 0;
+        return count;
+    }
+
+    keyset_spill(s);
+
+    /* k-way merge; the heads of the runs live in the (now empty) slots. */
+    uint64_t *head = s->slots;
+    size_t    k    = s->run_count;
+    uint64_t  last = 0;
+
+    for (size_t r = 0; r < k; r++) {
+        if (fread(&head[r], sizeof(uint64_t), 1, s->runs[r]) != 1) {
+            head[r] = 0;
+        }
+    }
+    for (;;) {
+        size_t min = k;
+        for (size_t r = 0; r < k; r++) {
+            if (head[r] && (min == k || head[r] < head[min])) {
+                min = r;
+            }
+        }
+        if (min == k) {
+            break;
+        }
+        if (head[min] != last) {
+            last = head[min];
+            fwrite(&last, sizeof(uint64_t), 1, out);
+            count++;
+        }
+        if (fread(&head[min], sizeof(uint64_t), 1, s->runs[min]) != 1) {
+            head[min] = 0;
+        }
+    }
+
+    for (size_t r = 0; r < k; r++) {
+        fclose(s->runs[r]);
+        head[r] = 0;
+    }
+    s->run_count = 0;
+    return count;
+}
+
+static void keyset_destroy(KeySet *s) {
+    for (size_t r = 0; r < s->run_count; r++) {
+        fclose(s->runs[r]);
+    }
+    free(s->runs);
+    free(s->slots);
+}
+
+/* Children of a chunk of frontier keys, terminal positions flagged. */
+typedef struct {
+    uint64_t  in[CHUNK_KEYS];
+    size_t    n_in;
+    uint64_t  out[CHUNK_KEYS * COLS];
+    size_t    n_out;
+    PoolTask  task;
+} ExpandTask;
+
+static void expand_main(void *arg) {
+    ExpandTask *t = (ExpandTask*)arg;
+    t->n_out = 0;
+
+    for (size_t i = 0; i < t->n_in; i++) {
+        if (t->in[i] & KEY_TERMINAL) continue;
+
+        Board b;
+        position_from_key(t->in[i], &b);
+        Cell p = side_to_move(&b);
+
+        for (int c = 1; c <= COLS; c++) {
+            int row;
+            if (!board_drop(&b, c, p, &row)) continue;
+
+            uint64_t key = position_key(&b);
+            if (board_is_winning(&b, row, c - 1, p)) {
+                key |= KEY_TERMINAL;
+            }
+            t->out[t->n_out++] = key;
+            board_undo(&b, NULL);
+        }
+    }
+}
+
+/* Breadth-first: each ply's distinct positions are the next frontier. */
+static void count_distinct(const Board *start, int depth, ThreadPool *pool,
+                           size_t set_bytes, uint64_t *counts, double *ms,
+                           uint64_t *spilled) {
+    int         ntasks = pool->workers * 4;
+    ExpandTask *tasks  = malloc(sizeof(*tasks) * (size_t)ntasks);
+    KeySet      set;
+
+    if (!tasks || keyset_init(&set, set_bytes) != 0) {
+        fprintf(stderr, "perft: out of memory\n");
+        exit(1);
+    }
+
+    FILE    *frontier = spill_file();
+    uint64_t root     = position_key(start);
+    fwrite(&root, sizeof(root), 1, frontier);
+    counts[0] = 1;
+
+    for (int ply = 1; ply <= depth; ply++) {
+        double t0 = now_ms();
+        rewind(frontier);
+
+        for (;;) {
+            int used = 0;
+            while (used < ntasks) {
+                ExpandTask *t = &tasks[used];
+                t->n_in = fread(t->in, sizeof(uint64_t), CHUNK_KEYS, frontier);
+                if (t->n_in == 0) break;
+                pool_submit(pool, &t->task, expand_main, t);
+                used++;
+            }
+            if (used == 0) {
+                break;
+            }
+            for (int i = 0; i < used; i++) {
+                pool_wait(pool, &tasks[i].task);
+                for (size_t j = 0; j < tasks[i].n_out; j++) {
+                    keyset_insert(&set, tasks[i].out[j]);
+                }
+            }
+        }
+
+        uint64_t before = set.spilled;
+        FILE    *next   = spill_file();
+        counts[ply]  = keyset_drain(&set, next);
+        spilled[ply] = set.spilled - before;
+        fclose(frontier);
+        frontier = next;
+        ms[ply]  = now_ms() - t0;
+
+        if (counts[ply] == 0) {
+            break;
+        }
+    }
+
+    fclose(frontier);
+    keyset_destroy(&set);
+    free(tasks);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static const char *check(const uint64_t *known, int known_n, int ply, uint64_t v,
+                         bool from_empty, int *mismatches) {
+    if (!from_empty || ply >= known_n) {
+        return "";
+    }
+    if (known[ply] == v) {
+        return "ok";
+    }
+    (*mismatches)++;
+    return "MISMATCH";
+}
+
+int main(int argc, char **argv) {
+    int         depth     = 9;
+    const char *moves     = "";
+    int         threads   = pool_default_workers();
+    size_t      mb        = 256;
+    bool        sequences = true;
+    bool        distinct  = true;
+    int         opt;
+
+    g_tmp_dir = getenv("TMPDIR");
+    if (!g_tmp_dir || !*g_tmp_dir) {
+        g_tmp_dir = "/tmp";
+    }
+
+    while ((opt = getopt(argc, argv, "d:p:j:m:T:su")) != -1) {
+        switch (opt) {
+            case 'd': depth     = atoi(optarg);             break;
+            case 'p': moves     = optarg;                   break;
+            case 'j': threads   = atoi(optarg);             break;
+            case 'm': mb        = (size_t)atol(optarg);     break;
+            case 'T': g_tmp_dir = optarg;                   break;
+            case 's': distinct  = false;                    break;
+            case 'u': sequences = false;                    break;
+            default:
+                fprintf(stderr, "usage: %s [-d DEPTH] [-p MOVES] [-j THREADS] [-m MB] "
+                        "[-T DIR] [-s | -u]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    Board start;
+    board_init(&start);
+    int played = board_play_sequence(&start, moves);
+    if (played < 0) {
+        fprintf(stderr, "perft: invalid move sequence '%s'\n", moves);
+        return 2;
+    }
+    if (depth < 1 || depth > MAX_PLY - played || threads < 1 || mb < 1 ||
+        (!sequences && !distinct)) {
+        fprintf(stderr, "perft: need 1 <= DEPTH <= %d, THREADS >= 1, MB >= 1 "
+                "and at most one of -s and -u\n", MAX_PLY - played);
+        return 2;
+    }
+
+    ThreadPool pool;
+    if (pool_init(&pool, threads) != 0) {
+        fprintf(stderr, "perft: could not start the thread pool\n");
+        return 1;
+    }
+
+    bool from_empty = (played == 0);
+    printf("perft from '%s' to depth %d on %d threads\n", moves, depth, pool.workers);
+
+    uint64_t seq[MAX_PLY + 1] = { 0 };
+    if (sequences) {
+        double t0 = now_ms();
+        count_sequences(&start, depth, &pool, seq);
+        double ms = now_ms() - t0;
+
+        uint64_t nodes = 0;
+        for (int ply = 1; ply <= depth; ply++) {
+            nodes += seq[ply];
+        }
+        printf("sequences: %llu nodes in %.1f ms (%.2f Mnodes/s)\n",
+               (unsigned long long)nodes, ms, ms > 0 ? nodes / ms / 1e3 : 0.0);
+    }
+
+    uint64_t dist[MAX_PLY + 1]    = { 0 };
+    double   dist_ms[MAX_PLY + 1] = { 0 };
+    uint64_t spilled[MAX_PLY + 1] = { 0 };
+    if (distinct) {
+        count_distinct(&start, depth, &pool, mb << 20, dist, dist_ms, spilled);
+    }
+
+    int mismatches = 0;
+    printf("%4s", "ply");
+    if (sequences) {
+        printf(" %16s %-8s", "sequences", "");
+    }
+    if (distinct) {
+        /* throughput: frontier positions of the ply before expanded per second */
+        printf(" %14s %-8s %10s %10s %s", "distinct", "", "ms", "Mpos/s", "spilled");
+    }
+    printf("\n");
+
+    for (int ply = 0; ply <= depth; ply++) {
+        printf("%4d", ply);
+        if (sequences) {
+            printf(" %16llu %-8s", (unsigned long long)seq[ply],
+                   check(KNOWN_SEQUENCES, KNOWN_COUNT(KNOWN_SEQUENCES), ply, seq[ply],
+                         from_empty, &mismatches));
+        }
+        if (distinct) {
+            double rate = (ply > 0 && dist_ms[ply] > 0) ? dist[ply - 1] / dist_ms[ply] / 1e3 : 0.0;
+            printf(" %14llu %-8s %10.1f %10.2f %llu", (unsigned long long)dist[ply],
+                   check(KNOWN_DISTINCT, KNOWN_COUNT(KNOWN_DISTINCT), ply, dist[ply],
+                         from_empty, &mismatches),
+                   dist_ms[ply], rate, (unsigned long long)spilled[ply]);
+        }
+        printf("\n");
+    }
+
+    pool_destroy(&pool);
+    if (mismatches) {
+        printf("%d counts differ from the published ones\n", mismatches);
+        return 1;
+    }
+    return 0;
+}